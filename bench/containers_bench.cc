@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../statebased/map.hh"
+
+/// Compares the lookup and merge throughput of CRDTs stored in std::unordered_map (StdContainers) and in flat
+/// hash tables (FlatContainers). Build with optimizations, e.g., -DCMAKE_BUILD_TYPE=Release, and run
+/// crdts_bench [elements].
+
+namespace {
+    const size_t LOOKUPS = 1 << 20;
+
+    template<typename Function>
+    double seconds(Function f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char* name, const char* containers, size_t ops, double time) {
+        std::printf("%-28s %-6s %10.2f Mops/s\n", name, containers, ops / time / 1e6);
+    }
+
+    /// Looks up random elements, half of which exist, one by one and in batches
+    template<typename Containers>
+    void set_lookups(const char* containers, size_t elements) {
+        std::mt19937_64 rand(1);
+        ORSet<uint64_t, 0, Containers> set(1);
+        for (size_t i = 0; i < elements; ++i)
+            set.add(2 * i);
+
+        std::vector<uint64_t> keys(LOOKUPS);
+        for (auto& k: keys)
+            k = rand() % (2 * elements);
+
+        size_t found = 0;
+        report("ORSet::contains", containers, LOOKUPS, seconds([&]() {
+            for (auto k: keys)
+                found += set.contains(k);
+        }));
+        report("ORSet::contains_many", containers, LOOKUPS, seconds([&]() {
+            auto result = set.contains_many(keys);
+            for (bool r: result)
+                found += r;
+        }));
+
+        if (found == 0)
+            std::printf("no element found\n");
+    }
+
+    /// Gets random string keys of a map, one by one and in batches; flat maps take std::string_view keys
+    template<typename Containers>
+    void map_lookups(const char* containers, size_t elements) {
+        std::mt19937_64 rand(2);
+        Map<std::string, uint64_t, 0, Containers> map(1);
+        for (size_t i = 0; i < elements; ++i)
+            map.put("user:" + std::to_string(i) + ":profile", i);
+
+        std::vector<std::string> strings(LOOKUPS);
+        for (auto& k: strings)
+            k = "user:" + std::to_string(rand() % elements) + ":profile";
+        std::vector<typename std::decay<typename Map<std::string, uint64_t, 0, Containers>::Lookup>::type> keys(
+                strings.begin(), strings.end());
+
+        uint64_t sum = 0;
+        report("Map::get", containers, LOOKUPS, seconds([&]() {
+            for (const auto& k: keys)
+                sum += map.get(k);
+        }));
+        report("Map::get_many", containers, LOOKUPS, seconds([&]() {
+            for (auto val: map.get_many(keys))
+                sum += *val;
+        }));
+
+        if (sum == 0)
+            std::printf("no value found\n");
+    }
+
+    /// Merges two sets that share half of their elements, and have removed a tenth of each other's elements
+    template<typename Containers>
+    void set_merges(const char* containers, size_t elements) {
+        ORSet<uint64_t, 0, Containers> set1(1), set2(2);
+        for (size_t i = 0; i < elements; ++i)
+            set1.add(i);
+        set2.merge(set1);
+        for (size_t i = 0; i < elements; ++i) {
+            set2.add(elements + i);
+            if (i % 10 == 0)
+                set2.remove(i);
+        }//for
+        for (size_t i = 5; i < elements; i += 10)
+            set1.remove(i);
+
+        const size_t merges = 5;
+        double time = 0;
+        for (size_t i = 0; i < merges; ++i) {
+            auto local = set1;
+            time += seconds([&]() { local.merge(set2); });
+        }//for
+        report("ORSet::merge", containers, merges * 3 * elements, time);
+    }
+
+    template<typename Containers>
+    void map_merges(const char* containers, size_t elements) {
+        Map<std::string, uint64_t, 0, Containers> map1(1), map2(2);
+        for (size_t i = 0; i < elements; ++i)
+            map1.put(std::to_string(i), i);
+        map2.merge(map1);
+        for (size_t i = 0; i < elements; i += 2)
+            map2.put(std::to_string(i), 2 * i);
+
+        const size_t merges = 5;
+        double time = 0;
+        for (size_t i = 0; i < merges; ++i) {
+            auto local = map1;
+            time += seconds([&]() { local.merge(map2); });
+        }//for
+        report("Map::merge", containers, merges * elements, time);
+    }
+}//namespace
+
+int main(int argc, char* argv[]) {
+    size_t elements = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::printf("%zu elements, throughput in elements per second\n", elements);
+
+    set_lookups<StdContainers>("std", elements);
+    set_lookups<FlatContainers>("flat", elements);
+    map_lookups<StdContainers>("std", elements);
+    map_lookups<FlatContainers>("flat", elements);
+    set_merges<StdContainers>("std", elements);
+    set_merges<FlatContainers>("flat", elements);
+    map_merges<StdContainers>("std", elements);
+    map_merges<FlatContainers>("flat", elements);
+    return 0;
+}
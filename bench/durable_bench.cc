@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include "../statebased/durable.hh"
+
+/// Compares the throughput of puts to a Map and to a DurableMap with group commit. Build with optimizations, e.g.,
+/// -DCMAKE_BUILD_TYPE=Release, and run crdts_durable_bench [puts] [group size] [directory].
+
+namespace {
+    const size_t VALUE_SIZE = 100;
+
+    template<typename Function>
+    double seconds(Function f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char* name, size_t ops, double time) {
+        std::printf("%-24s %10.2f Kops/s\n", name, ops / time / 1e3);
+    }
+}//namespace
+
+int main(int argc, char* argv[]) {
+    size_t puts = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    WALOptions options;
+    options.group_size = argc > 2 ? std::stoul(argv[2]) : 1024;
+    std::string path = std::string(argc > 3 ? argv[3] : ".") + "/crdts_durable_bench";
+    std::printf("%zu puts of %zu byte values, groups of %zu records\n", puts, VALUE_SIZE, options.group_size);
+
+    // Keys are reused, so the state stays smaller than the log as in a workload of updates
+    auto key = [puts](size_t i) { return "key:" + std::to_string(i % (puts / 4 + 1)); };
+    std::string value(VALUE_SIZE, 'v');
+
+    // The best of a few rounds of each, since a durable put waits for the disk
+    const size_t rounds = 3;
+    double in_memory = 0, durable = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        {
+            Map<std::string, std::string> map(1);
+            auto time = seconds([&]() {
+                for (size_t i = 0; i < puts; ++i)
+                    map.put(key(i), value);
+            });
+            in_memory = r == 0 ? time : std::min(in_memory, time);
+        }
+        {
+            ::unlink((path + ".wal").c_str());
+            ::unlink((path + ".deltas").c_str());
+            ::unlink((path + ".checkpoint").c_str());
+            DurableMap<std::string, std::string> map(1, path, options);
+            auto time = seconds([&]() {
+                for (size_t i = 0; i < puts; ++i)
+                    map.put(key(i), value);
+                map.sync();
+            });
+            durable = r == 0 ? time : std::min(durable, time);
+        }
+    }//for
+    report("Map::put", puts, in_memory);
+    report("DurableMap::put", puts, durable);
+    std::printf("durable/in-memory time %.2f\n", durable / in_memory);
+
+    ::unlink((path + ".wal").c_str());
+    ::unlink((path + ".deltas").c_str());
+    ::unlink((path + ".checkpoint").c_str());
+    return 0;
+}
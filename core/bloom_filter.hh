@@ -0,0 +1,156 @@
+#ifndef CRDTS_BLOOM_FILTER_HH
+#define CRDTS_BLOOM_FILTER_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "memory_usage.hh"
+#include "serializer.hh"
+
+/// BloomFilter summarizes a set of hash codes in a bit array: each inserted hash code sets a number of bits
+/// derived from it by double hashing, and a hash code whose bits are not all set has not been inserted. A query
+/// therefore has no false negatives, and false positives at a rate set by the bits per inserted hash code, about
+/// 1% for 10 bits. Bits cannot be cleared, so a filter of a set that shrinks only gains false positives; the
+/// owner of a filter rebuilds it when more hash codes have been inserted than it was sized for. An empty filter,
+/// one created by the default constructor, summarizes nothing and contains every hash code.
+class BloomFilter {
+private:
+    std::vector<uint64_t> _words;
+    uint32_t _hashes{};    // The number of bits set per hash code
+    uint32_t _bits_per_hash{}; // The number of bits per hash code the filter was sized with
+    uint64_t _capacity{};  // The number of hash codes the filter was sized for
+    uint64_t _inserted{};  // The number of hash codes inserted, including those of removed elements
+
+    /// Gets the step between the bits of a hash code, which must be odd to visit distinct bits
+    static uint64_t _step(uint64_t hash) {
+        hash ^= hash >> 31;
+        hash *= 0x7fb5d329728ea185ULL;
+        hash ^= hash >> 27;
+        return hash | 1;
+    }
+
+public:
+    BloomFilter() = default;
+
+    /// Creates a filter for a given number of hash codes
+    /// \param capacity the number of hash codes
+    /// \param bits_per_hash the number of bits per hash code, which sets the rate of false positives
+    explicit BloomFilter(uint64_t capacity, uint32_t bits_per_hash = 10) :
+            _words((std::max<uint64_t>(capacity, 64) * bits_per_hash + 63) / 64),
+            _hashes(std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(bits_per_hash * std::log(2.0))))),
+            _bits_per_hash(bits_per_hash), _capacity(std::max<uint64_t>(capacity, 64)) { }
+
+    /// Inserts a hash code
+    /// \param hash the hash code
+    void insert(uint64_t hash) {
+        if (_words.empty())
+            return;
+
+        auto bits = _words.size() * 64, step = _step(hash);
+        for (uint32_t i = 0; i < _hashes; ++i, hash += step) {
+            auto bit = hash % bits;
+            _words[bit / 64] |= uint64_t(1) << (bit % 64);
+        }//for
+        ++_inserted;
+    }
+
+    /// Checks if a hash code may have been inserted
+    /// \param hash the hash code
+    /// \return false if the hash code has not been inserted, true if it may have been inserted
+    bool may_contain(uint64_t hash) const {
+        if (_words.empty())
+            return true;
+
+        auto bits = _words.size() * 64, step = _step(hash);
+        for (uint32_t i = 0; i < _hashes; ++i, hash += step) {
+            auto bit = hash % bits;
+            if ((_words[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+                return false;
+        }//for
+
+        return true;
+    }
+
+    /// Checks if the filter summarizes nothing
+    /// \return true if the filter was created by the default constructor, otherwise false
+    bool empty() const {
+        return _words.empty();
+    }
+
+    /// Checks if more hash codes have been inserted than the filter was sized for
+    /// \return true if the filter must be rebuilt to keep its rate of false positives, otherwise false
+    bool full() const {
+        return _inserted > _capacity;
+    }
+
+    /// Gets the number of hash codes the filter was sized for
+    /// \return the capacity
+    uint64_t capacity() const {
+        return _capacity;
+    }
+
+    /// Gets the number of inserted hash codes
+    /// \return the number of inserted hash codes
+    uint64_t inserted() const {
+        return _inserted;
+    }
+
+    /// Gets the number of bits per hash code the filter was created with
+    /// \return the number of bits
+    uint32_t bits_per_hash() const {
+        return _bits_per_hash;
+    }
+
+    /// Gets the memory footprint of the filter, all of which is metadata
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.metadata = _words.size() * sizeof(uint64_t);
+        usage.overhead = (_words.capacity() - _words.size()) * sizeof(uint64_t);
+        return usage;
+    }
+
+    /// Writes the filter to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint32_t>::write(out, _hashes);
+        Serializer<uint32_t>::write(out, _bits_per_hash);
+        Serializer<uint64_t>::write(out, _capacity);
+        Serializer<uint64_t>::write(out, _inserted);
+        Serializer<uint64_t>::write(out, _words.size());
+        for (auto word: _words)
+            Serializer<uint64_t>::write(out, word);
+    }
+
+    /// Replaces the filter with a filter written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the filter was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        uint32_t hashes, bits_per_hash;
+        uint64_t capacity, inserted, words;
+        if (!Serializer<uint32_t>::read(in, hashes) or !Serializer<uint32_t>::read(in, bits_per_hash) or
+            !Serializer<uint64_t>::read(in, capacity) or !Serializer<uint64_t>::read(in, inserted) or
+            !Serializer<uint64_t>::read(in, words) or (words > 0 and hashes == 0))
+            return false;
+
+        std::vector<uint64_t> words_read;
+        for (uint64_t i = 0; i < words; ++i) {
+            uint64_t word;
+            if (!Serializer<uint64_t>::read(in, word))
+                return false;
+            words_read.push_back(word);
+        }//for
+
+        _words.swap(words_read);
+        _hashes = hashes;
+        _bits_per_hash = bits_per_hash;
+        _capacity = capacity;
+        _inserted = inserted;
+        return true;
+    }
+};
+
+#endif //CRDTS_BLOOM_FILTER_HH
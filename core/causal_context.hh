@@ -0,0 +1,367 @@
+#ifndef CRDTS_CAUSAL_CONTEXT_HH
+#define CRDTS_CAUSAL_CONTEXT_HH
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "memory_usage.hh"
+#include "serializer.hh"
+
+/// The observed sequence numbers of a replica in a causal context
+struct CausalRange {
+    uint64_t prefix{}; // Sequence numbers 1 to prefix are observed
+    std::vector<uint64_t> exceptions; // Sorted sequence numbers greater than prefix + 1 that are observed
+
+    /// Gets the largest observed sequence number
+    /// \return the largest observed sequence number, 0 if nothing is observed
+    uint64_t max() const {
+        return exceptions.empty() ? prefix : exceptions.back();
+    }
+};
+
+/// FixedRanges stores the ranges of a causal context for a fixed number of replicas, whose identifiers are
+/// 0 to N - 1, in an array. It provides the part of the interface of std::unordered_map used by a context;
+/// iterators visit the replicas that have been added to the context.
+template<size_t N>
+class FixedRanges {
+private:
+    std::array<std::pair<uint64_t, CausalRange>, N> _ranges;
+    std::array<bool, N> _added{};
+
+public:
+    using value_type = std::pair<uint64_t, CausalRange>;
+
+    class const_iterator {
+    private:
+        const FixedRanges<N>* _ranges;
+        size_t _index;
+
+        void _skip() {
+            while (_index < N and !_ranges->_added[_index])
+                ++_index;
+        }
+
+    public:
+        const_iterator(const FixedRanges<N>* ranges, size_t index) : _ranges(ranges), _index(index) {
+            _skip();
+        }
+
+        const value_type& operator * () const {
+            return _ranges->_ranges[_index];
+        }
+
+        const value_type* operator -> () const {
+            return &_ranges->_ranges[_index];
+        }
+
+        const_iterator& operator ++ () {
+            ++_index;
+            _skip();
+            return *this;
+        }
+
+        friend bool operator == (const const_iterator& i1, const const_iterator& i2) {
+            return i1._index == i2._index;
+        }
+
+        friend bool operator != (const const_iterator& i1, const const_iterator& i2) {
+            return i1._index != i2._index;
+        }
+    };
+
+    FixedRanges() {
+        for (size_t i = 0; i < N; ++i)
+            _ranges[i].first = i;
+    }
+
+    /// Gets the range of a given replica, and adds the replica if it has not been added
+    /// \param replica_id the identifier of the replica, which must be less than N
+    /// \return the range of the replica
+    CausalRange& operator [] (uint64_t replica_id) {
+        _added[replica_id] = true;
+        return _ranges[replica_id].second;
+    }
+
+    const_iterator find(uint64_t replica_id) const {
+        return replica_id < N and _added[replica_id] ? const_iterator(this, replica_id) : end();
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, N);
+    }
+
+    size_t size() const {
+        return std::count(_added.begin(), _added.end(), true);
+    }
+
+    void swap(FixedRanges<N>& ranges) {
+        _ranges.swap(ranges._ranges);
+        _added.swap(ranges._added);
+    }
+};
+
+/// Fixed ranges are stored in an array that has no hash table overhead
+template<size_t N>
+size_t hash_table_overhead(const FixedRanges<N>&) {
+    return 0;
+}
+
+/// BasicCausalContext stores the set of operations observed by a replica. Each operation is identified by a dot,
+/// that is, the identifier of the replica that performed the operation and a sequence number that the replica
+/// assigned to it. For each replica, the context keeps the contiguous prefix of observed sequence numbers, i.e.,
+/// sequence numbers 1 to n, plus a sorted set of sequence numbers observed out of order (exceptions).
+/// Exceptions are compacted into the prefix as soon as the gap before them is filled, so the context stays as
+/// small as a version vector when operations are observed in order. Ranges is the container mapping replica
+/// identifiers to their ranges: a hash table in CausalContext, and an array in FixedCausalContext.
+template<typename Ranges>
+class BasicCausalContext {
+public:
+    using Range = CausalRange;
+
+private:
+    Ranges _ranges;
+
+    /// Moves exceptions that extend the prefix of a given range into the prefix
+    static void _compact(Range& range) {
+        size_t compacted = 0;
+        while (compacted < range.exceptions.size() and range.exceptions[compacted] <= range.prefix + 1) {
+            range.prefix = std::max(range.prefix, range.exceptions[compacted]);
+            ++compacted;
+        }//while
+
+        if (compacted > 0)
+            range.exceptions.erase(range.exceptions.begin(), range.exceptions.begin() + compacted);
+    }
+
+public:
+    /// Adds a replica to the context without observing any of its operations
+    /// \param replica_id the identifier of the replica
+    void add_replica(uint64_t replica_id) {
+        _ranges[replica_id];
+    }
+
+    /// Adds a dot to the context
+    /// \param replica_id the identifier of the replica
+    /// \param seq_number the sequence number of the dot
+    void add(uint64_t replica_id, uint64_t seq_number) {
+        auto& range = _ranges[replica_id];
+        if (seq_number <= range.prefix)
+            return;
+
+        if (seq_number == range.prefix + 1) {
+            // The common case: operations of a replica are observed in order
+            range.prefix = seq_number;
+            if (!range.exceptions.empty())
+                _compact(range);
+            return;
+        }//if
+
+        auto pos = std::lower_bound(range.exceptions.begin(), range.exceptions.end(), seq_number);
+        if (pos == range.exceptions.end() or *pos != seq_number)
+            range.exceptions.insert(pos, seq_number);
+    }
+
+    /// Adds the dots of a given replica up to a given sequence number to the context
+    /// \param replica_id the identifier of the replica
+    /// \param seq_number the given sequence number
+    void add_prefix(uint64_t replica_id, uint64_t seq_number) {
+        auto& range = _ranges[replica_id];
+        if (seq_number <= range.prefix)
+            return;
+
+        range.prefix = seq_number;
+        range.exceptions.erase(range.exceptions.begin(),
+                               std::upper_bound(range.exceptions.begin(), range.exceptions.end(), seq_number));
+        _compact(range);
+    }
+
+    /// Checks if a given dot has been observed
+    /// \param replica_id the identifier of the replica
+    /// \param seq_number the sequence number of the dot
+    /// \return true if the dot is in the context, otherwise false
+    bool contains(uint64_t replica_id, uint64_t seq_number) const {
+        auto range = _ranges.find(replica_id);
+        if (range == _ranges.end())
+            return false;
+
+        return seq_number <= range->second.prefix or
+               std::binary_search(range->second.exceptions.begin(), range->second.exceptions.end(), seq_number);
+    }
+
+    /// Checks if all dots of another context are in this context
+    /// \param context the other context
+    /// \return true if the other context is included in this context, otherwise false
+    bool includes(const BasicCausalContext<Ranges>& context) const {
+        for (const auto& r: context._ranges) {
+            auto range = _ranges.find(r.first);
+            if (range == _ranges.end()) {
+                if (r.second.max() > 0)
+                    return false;
+                continue;
+            }//if
+
+            if (r.second.prefix > range->second.prefix) {
+                // The sequence numbers between the two prefixes must be exceptions of this context
+                if (r.second.prefix - range->second.prefix > range->second.exceptions.size())
+                    return false;
+                for (auto seq = range->second.prefix + 1; seq <= r.second.prefix; ++seq) {
+                    if (!std::binary_search(range->second.exceptions.begin(), range->second.exceptions.end(), seq))
+                        return false;
+                }//for
+            }//if
+
+            for (auto seq: r.second.exceptions) {
+                if (!contains(r.first, seq))
+                    return false;
+            }//for
+        }//for
+
+        return true;
+    }
+
+    /// Gets the largest sequence number observed from a given replica
+    /// \param replica_id the identifier of the replica
+    /// \return the largest observed sequence number, 0 if nothing is observed
+    uint64_t max(uint64_t replica_id) const {
+        auto range = _ranges.find(replica_id);
+        return range == _ranges.end() ? 0 : range->second.max();
+    }
+
+    /// Adds the dots of another context to this context
+    /// \param context the other context
+    void join(const BasicCausalContext<Ranges>& context) {
+        for (const auto& r: context._ranges) {
+            auto& range = _ranges[r.first];
+            range.prefix = std::max(range.prefix, r.second.prefix);
+
+            if (!r.second.exceptions.empty() or !range.exceptions.empty()) {
+                // Union of sorted exceptions that are not covered by the prefix
+                std::vector<uint64_t> exceptions;
+                exceptions.reserve(range.exceptions.size() + r.second.exceptions.size());
+                std::set_union(range.exceptions.begin(), range.exceptions.end(),
+                               r.second.exceptions.begin(), r.second.exceptions.end(), std::back_inserter(exceptions));
+                exceptions.erase(exceptions.begin(),
+                                 std::upper_bound(exceptions.begin(), exceptions.end(), range.prefix));
+                range.exceptions.swap(exceptions);
+                _compact(range);
+            }//if
+        }//for
+    }
+
+    /// Gets the number of sequence numbers stored out of order
+    /// \return the number of exceptions
+    size_t exceptions() const {
+        size_t result = 0;
+        for (const auto& r: _ranges)
+            result += r.second.exceptions.size();
+
+        return result;
+    }
+
+    /// Gets the memory footprint of the context, all of which is metadata or hash table overhead
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.overhead = hash_table_overhead(_ranges);
+        for (const auto& r: _ranges)
+            usage.metadata += sizeof(r) + r.second.exceptions.capacity() * sizeof(uint64_t);
+
+        return usage;
+    }
+
+    /// Iterators over pairs of replica identifiers and their observed ranges
+    typename Ranges::const_iterator begin() const {
+        return _ranges.begin();
+    }
+
+    typename Ranges::const_iterator end() const {
+        return _ranges.end();
+    }
+
+    /// Swaps the context with another context
+    /// \param context the other context
+    void swap(BasicCausalContext<Ranges>& context) {
+        _ranges.swap(context._ranges);
+    }
+
+    /// Writes the context to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _ranges.size());
+        for (const auto& r: _ranges) {
+            Serializer<uint64_t>::write(out, r.first);
+            Serializer<uint64_t>::write(out, r.second.prefix);
+            Serializer<uint64_t>::write(out, r.second.exceptions.size());
+            for (auto seq: r.second.exceptions)
+                Serializer<uint64_t>::write(out, seq);
+        }//for
+    }
+
+    /// Replaces the context with a context written by serialize to a stream
+    /// \param in the stream
+    /// \param max_replicas the number of replicas that the ranges can store, 0 if there is no limit
+    /// \return true if the context was read successfully, otherwise false
+    bool deserialize(std::istream& in, size_t max_replicas = 0) {
+        uint64_t ranges;
+        if (!Serializer<uint64_t>::read(in, ranges))
+            return false;
+
+        Ranges ranges_read;
+        for (uint64_t i = 0; i < ranges; ++i) {
+            uint64_t replica_id, exceptions;
+            Range range;
+            if (!Serializer<uint64_t>::read(in, replica_id) or !Serializer<uint64_t>::read(in, range.prefix) or
+                !Serializer<uint64_t>::read(in, exceptions) or (max_replicas > 0 and replica_id >= max_replicas))
+                return false;
+
+            // Exceptions are appended as they are read, so a corrupted count fails at the end of the stream
+            for (uint64_t e = 0; e < exceptions; ++e) {
+                uint64_t seq;
+                if (!Serializer<uint64_t>::read(in, seq))
+                    return false;
+                range.exceptions.push_back(seq);
+            }//for
+            ranges_read[replica_id] = std::move(range);
+        }//for
+
+        _ranges.swap(ranges_read);
+        return true;
+    }
+
+    /// Compares the equality of two contexts
+    /// \param c1 the first context
+    /// \param c2 the second context
+    /// \return true if the two contexts contain the same replicas and dots, otherwise false
+    friend bool operator == (const BasicCausalContext<Ranges>& c1, const BasicCausalContext<Ranges>& c2) {
+        if (c1._ranges.size() != c2._ranges.size())
+            return false;
+
+        for (const auto& r: c1._ranges) {
+            auto range = c2._ranges.find(r.first);
+            if (range == c2._ranges.end() or range->second.prefix != r.second.prefix or
+                range->second.exceptions != r.second.exceptions)
+                return false;
+        }//for
+
+        return true;
+    }
+};
+
+/// CausalContext is a causal context for any number of replicas
+using CausalContext = BasicCausalContext<std::unordered_map<uint64_t, CausalRange>>;
+
+/// FixedCausalContext is a causal context for a fixed number of replicas with identifiers 0 to N - 1
+template<size_t N>
+using FixedCausalContext = BasicCausalContext<FixedRanges<N>>;
+
+#endif //CRDTS_CAUSAL_CONTEXT_HH
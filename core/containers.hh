@@ -0,0 +1,72 @@
+#ifndef CRDTS_CONTAINERS_HH
+#define CRDTS_CONTAINERS_HH
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "flat_hash_map.hh"
+
+/// A containers policy selects the hash tables in which ORSet, Map, and GCounter store their entries, and the
+/// type of keys accepted by their lookups:
+/// - StdContainers, the default, stores entries in std::unordered_map, and lookups take the key type, and
+/// - FlatContainers stores entries in FlatHashMap, and lookups of std::string keys take std::string_view, so
+///   looking up a string literal or a substring does not construct a std::string.
+struct StdContainers {
+    template<typename KeyType, typename ValueType>
+    using Map = std::unordered_map<KeyType, ValueType>;
+
+    template<typename KeyType>
+    using Lookup = const KeyType&;
+};
+
+template<typename KeyType>
+struct FlatLookup {
+    using type = const KeyType&;
+};
+
+template<>
+struct FlatLookup<std::string> {
+    using type = std::string_view;
+};
+
+struct FlatContainers {
+    template<typename KeyType, typename ValueType>
+    using Map = FlatHashMap<KeyType, ValueType>;
+
+    template<typename KeyType>
+    using Lookup = typename FlatLookup<KeyType>::type;
+};
+
+/// Finds several keys in a hash table one by one
+/// \param table the hash table
+/// \param n the number of keys
+/// \param key a function that returns the i-th key
+/// \param found a function called with the index of each key and an iterator to its entry, or end()
+template<typename Table, typename KeyAt, typename Function>
+void find_many(const Table& table, size_t n, KeyAt key, Function found) {
+    for (size_t i = 0; i < n; ++i)
+        found(i, table.find(key(i)));
+}
+
+/// Finds several keys in a flat hash table, prefetching the groups of the keys (see FlatHashMap::find_many)
+template<typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename KeyAt, typename Function>
+void find_many(const FlatHashMap<KeyType, ValueType, Hash, KeyEqual>& table, size_t n, KeyAt key, Function found) {
+    table.find_many(n, key, found);
+}
+
+/// Gets a value that changes whenever the entries of a hash table move to other buckets, which invalidates a
+/// scan of its buckets
+/// \param table the hash table
+/// \return the number of buckets of a std::unordered_map, or the number of rehashes of a FlatHashMap
+template<typename Table>
+size_t bucket_layout(const Table& table) {
+    return table.bucket_count();
+}
+
+template<typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+size_t bucket_layout(const FlatHashMap<KeyType, ValueType, Hash, KeyEqual>& table) {
+    return table.rehashes();
+}
+
+#endif //CRDTS_CONTAINERS_HH
@@ -0,0 +1,645 @@
+#ifndef CRDTS_FLAT_HASH_MAP_HH
+#define CRDTS_FLAT_HASH_MAP_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "memory_usage.hh"
+
+/// FlatHash hashes a value with std::hash and mixes the bits of the result, since std::hash of integers is
+/// the identity and a flat table uses the high bits to select a group and the low bits as a fingerprint.
+/// It is transparent: strings, i.e., values convertible to std::string_view such as std::string and C strings,
+/// are hashed as std::string_view, so a table of std::string keys can be searched by any of them.
+struct FlatHash {
+    using is_transparent = void;
+
+    template<typename T>
+    size_t operator () (const T& val) const {
+        uint64_t hash;
+        if constexpr (std::is_convertible<const T&, std::string_view>::value)
+            hash = std::hash<std::string_view>()(std::string_view(val));
+        else
+            hash = std::hash<T>()(val);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+};
+
+/// FlatGroup is a group of control bytes of a flat hash table that are probed at once. A control byte is
+/// EMPTY, DELETED, or the low 7 bits of the hash code of the entry in its slot. Matches are returned as a bit
+/// mask, bit i for the i-th control byte; SSE2 compares all bytes of a group with a single instruction, and
+/// other targets fall back to a loop.
+class FlatGroup {
+public:
+    static constexpr size_t WIDTH = 16;
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+
+private:
+#ifdef __SSE2__
+    __m128i _ctrl;
+#else
+    const int8_t* _ctrl;
+#endif
+
+public:
+#ifdef __SSE2__
+    explicit FlatGroup(const int8_t* ctrl) :
+            _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) { }
+
+    /// Gets the control bytes equal to a given fingerprint
+    uint32_t match(int8_t fingerprint) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(fingerprint), _ctrl));
+    }
+
+    /// Gets the empty control bytes
+    uint32_t match_empty() const {
+        return match(EMPTY);
+    }
+
+    /// Gets the empty or deleted control bytes, i.e., the negative ones
+    uint32_t match_free() const {
+        return _mm_movemask_epi8(_ctrl);
+    }
+#else
+    explicit FlatGroup(const int8_t* ctrl) : _ctrl(ctrl) { }
+
+    uint32_t match(int8_t fingerprint) const {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < WIDTH; ++i)
+            bits |= static_cast<uint32_t>(_ctrl[i] == fingerprint) << i;
+
+        return bits;
+    }
+
+    uint32_t match_empty() const {
+        return match(EMPTY);
+    }
+
+    uint32_t match_free() const {
+        uint32_t bits = 0;
+        for (size_t i = 0; i < WIDTH; ++i)
+            bits |= static_cast<uint32_t>(_ctrl[i] < 0) << i;
+
+        return bits;
+    }
+#endif
+
+    /// Gets the index of the lowest bit set in a non-zero mask
+    static size_t lowest(uint32_t bits) {
+#if defined(__GNUC__)
+        return __builtin_ctz(bits);
+#else
+        size_t index = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            ++index;
+        }//while
+
+        return index;
+#endif
+    }
+};
+
+/// FlatHashMap is an open addressing hash table in the style of SwissTable. Entries are stored in an array of
+/// slots, and a parallel array keeps one control byte per slot. A lookup hashes the key once, selects a group of
+/// 16 slots with the high bits of the hash code, and compares the low 7 bits with the control bytes of the whole
+/// group at once, so most lookups touch one cache line of control bytes and a single slot. Groups are probed
+/// quadratically, erased slots are marked DELETED, and the table grows when 7/8 of its slots are used.
+///
+/// FlatHashMap provides the part of the interface of std::unordered_map used by CRDTs, with these differences:
+/// - inserting an entry may move other entries, which invalidates all iterators and references, while erasing
+///   or extracting an entry only invalidates iterators to that entry,
+/// - entries are pairs of a key and a value whose key must not be modified,
+/// - a bucket is a slot holding at most one entry, and
+/// - find, count, and find_many accept any key type that Hash and KeyEqual accept, e.g., std::string_view for
+///   std::string keys with the default FlatHash and std::equal_to<>.
+template<typename KeyType, typename ValueType, typename Hash = FlatHash, typename KeyEqual = std::equal_to<>>
+class FlatHashMap {
+public:
+    using key_type = KeyType;
+    using mapped_type = ValueType;
+    using value_type = std::pair<KeyType, ValueType>;
+    using size_type = size_t;
+    using const_local_iterator = const value_type*;
+
+private:
+    static constexpr size_t WIDTH = FlatGroup::WIDTH;
+    // The number of keys whose groups are prefetched together in find_many
+    static constexpr size_t PREFETCH_BATCH = 16;
+
+    int8_t* _ctrl{};
+    value_type* _slots{};
+    size_t _capacity{}; // 0 or a power of two that is at least WIDTH
+    size_t _size{};
+    size_t _growth_left{}; // The number of empty slots that can be used before the table grows
+    size_t _rehashes{};
+    Hash _hash;
+    KeyEqual _equal;
+
+    template<bool Const>
+    class Iterator {
+        friend class FlatHashMap;
+
+    private:
+        using Table = typename std::conditional<Const, const FlatHashMap, FlatHashMap>::type;
+
+        Table* _table{};
+        size_t _index{};
+
+        void _skip() {
+            while (_index < _table->_capacity and _table->_ctrl[_index] < 0)
+                ++_index;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<Const, const value_type*, value_type*>::type;
+        using reference = typename std::conditional<Const, const value_type&, value_type&>::type;
+
+        Iterator() = default;
+
+        Iterator(Table* table, size_t index) : _table(table), _index(index) {
+            _skip();
+        }
+
+        operator Iterator<true> () const {
+            return Iterator<true>(_table, _index);
+        }
+
+        reference operator * () const {
+            return _table->_slots[_index];
+        }
+
+        pointer operator -> () const {
+            return _table->_slots + _index;
+        }
+
+        Iterator& operator ++ () {
+            ++_index;
+            _skip();
+            return *this;
+        }
+
+        Iterator operator ++ (int) {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        friend bool operator == (const Iterator& i1, const Iterator& i2) {
+            return i1._index == i2._index;
+        }
+
+        friend bool operator != (const Iterator& i1, const Iterator& i2) {
+            return i1._index != i2._index;
+        }
+    };
+
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /// A node holds an entry extracted from a table, which can be inserted into another table without copying
+    class node_type {
+    private:
+        std::optional<value_type> _value;
+
+    public:
+        node_type() = default;
+
+        explicit node_type(value_type&& value) : _value(std::move(value)) { }
+
+        bool empty() const {
+            return !_value;
+        }
+
+        KeyType& key() {
+            return _value->first;
+        }
+
+        ValueType& mapped() {
+            return _value->second;
+        }
+
+        value_type& value() {
+            return *_value;
+        }
+    };
+
+private:
+    static int8_t _fingerprint(size_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    size_t _first_group(size_t hash) const {
+        return (hash >> 7) & (_capacity / WIDTH - 1);
+    }
+
+    /// Finds the slot of a key with a given hash code
+    /// \return the slot, or the capacity if the key is not found
+    template<typename Key>
+    size_t _find(const Key& key, size_t hash) const {
+        if (_capacity == 0)
+            return 0;
+
+        auto fingerprint = _fingerprint(hash);
+        auto mask = _capacity / WIDTH - 1;
+        // Probing stops at a group with an empty slot, since an insert would have used that slot
+        for (size_t group = _first_group(hash), probes = 0; ; group = (group + ++probes) & mask) {
+            FlatGroup ctrl(_ctrl + group * WIDTH);
+            for (auto bits = ctrl.match(fingerprint); bits != 0; bits &= bits - 1) {
+                auto slot = group * WIDTH + FlatGroup::lowest(bits);
+                if (_equal(_slots[slot].first, key))
+                    return slot;
+            }//for
+
+            if (ctrl.match_empty() != 0)
+                return _capacity;
+        }//for
+    }
+
+    /// Finds the first empty or deleted slot on the probe sequence of a given hash code
+    size_t _find_free(size_t hash) const {
+        auto mask = _capacity / WIDTH - 1;
+        for (size_t group = _first_group(hash), probes = 0; ; group = (group + ++probes) & mask) {
+            auto bits = FlatGroup(_ctrl + group * WIDTH).match_free();
+            if (bits != 0)
+                return group * WIDTH + FlatGroup::lowest(bits);
+        }//for
+    }
+
+    /// Finds a free slot for a new entry with a given hash code, and grows or cleans up the table if needed
+    size_t _prepare_insert(size_t hash) {
+        if (_growth_left == 0) {
+            // Deleted slots are reclaimed in place if they take most of the used slots, otherwise the table grows
+            auto max_size = _capacity - _capacity / 8;
+            _rehash(_size < max_size / 2 ? _capacity : std::max(2 * _capacity, WIDTH));
+        }//if
+
+        return _find_free(hash);
+    }
+
+    /// Marks a slot that has been constructed as used
+    void _commit(size_t slot, size_t hash) {
+        if (_ctrl[slot] == FlatGroup::EMPTY)
+            --_growth_left;
+        _ctrl[slot] = _fingerprint(hash);
+        ++_size;
+    }
+
+    /// Constructs an entry for a key that does not exist in the table
+    template<typename Key, typename... Args>
+    size_t _insert(size_t hash, Key&& key, Args&&... args) {
+        auto slot = _prepare_insert(hash);
+        ::new (static_cast<void*>(_slots + slot)) value_type(std::piecewise_construct,
+                                                             std::forward_as_tuple(std::forward<Key>(key)),
+                                                             std::forward_as_tuple(std::forward<Args>(args)...));
+        _commit(slot, hash);
+        return slot;
+    }
+
+    /// Destroys the entry of a used slot
+    void _destroy(size_t slot) {
+        _slots[slot].~value_type();
+        _ctrl[slot] = FlatGroup::DELETED;
+        --_size;
+    }
+
+    void _allocate(size_t capacity) {
+        _capacity = capacity;
+        _growth_left = capacity - capacity / 8;
+        if (capacity == 0)
+            return;
+
+        _ctrl = new int8_t[capacity];
+        std::memset(_ctrl, FlatGroup::EMPTY, capacity);
+        _slots = std::allocator<value_type>().allocate(capacity);
+    }
+
+    void _release() {
+        if (_capacity == 0)
+            return;
+
+        for (size_t slot = 0; slot < _capacity; ++slot) {
+            if (_ctrl[slot] >= 0)
+                _slots[slot].~value_type();
+        }//for
+
+        delete[] _ctrl;
+        std::allocator<value_type>().deallocate(_slots, _capacity);
+        _ctrl = nullptr;
+        _slots = nullptr;
+    }
+
+    /// Moves all entries to a new array of slots with a given capacity
+    void _rehash(size_t capacity) {
+        auto ctrl = _ctrl;
+        auto slots = _slots;
+        auto old_capacity = _capacity;
+
+        _allocate(capacity);
+        for (size_t slot = 0; slot < old_capacity; ++slot) {
+            if (ctrl[slot] < 0)
+                continue;
+
+            auto hash = _hash(slots[slot].first);
+            auto new_slot = _find_free(hash);
+            ::new (static_cast<void*>(_slots + new_slot)) value_type(std::move(slots[slot]));
+            slots[slot].~value_type();
+            _ctrl[new_slot] = _fingerprint(hash);
+            --_growth_left;
+        }//for
+        ++_rehashes;
+
+        if (old_capacity > 0) {
+            delete[] ctrl;
+            std::allocator<value_type>().deallocate(slots, old_capacity);
+        }//if
+    }
+
+    void _prefetch(size_t hash) const {
+#if defined(__GNUC__)
+        auto group = _first_group(hash);
+        __builtin_prefetch(_ctrl + group * WIDTH);
+        __builtin_prefetch(_slots + group * WIDTH);
+#endif
+    }
+
+public:
+    FlatHashMap() = default;
+
+    FlatHashMap(const FlatHashMap& table) : _hash(table._hash), _equal(table._equal) {
+        // Entries keep their slots, and deleted slots are kept so that probe sequences are not cut short
+        _allocate(table._capacity);
+        for (size_t slot = 0; slot < table._capacity; ++slot) {
+            if (table._ctrl[slot] < 0) {
+                _ctrl[slot] = table._ctrl[slot];
+                continue;
+            }//if
+
+            try {
+                ::new (static_cast<void*>(_slots + slot)) value_type(table._slots[slot]);
+            } catch (...) {
+                _release();
+                throw;
+            }//catch
+            _ctrl[slot] = table._ctrl[slot];
+            ++_size;
+        }//for
+        _growth_left = table._growth_left;
+    }
+
+    FlatHashMap(FlatHashMap&& table) noexcept {
+        swap(table);
+    }
+
+    FlatHashMap& operator = (FlatHashMap table) noexcept {
+        swap(table);
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        _release();
+    }
+
+    /// Finds the entry of a given key
+    /// \param key the given key
+    /// \return an iterator to the entry, or end() if the key does not exist
+    template<typename Key>
+    iterator find(const Key& key) {
+        return iterator(this, _find(key, _hash(key)));
+    }
+
+    template<typename Key>
+    const_iterator find(const Key& key) const {
+        return const_iterator(this, _find(key, _hash(key)));
+    }
+
+    /// Counts the entries of a given key
+    /// \param key the given key
+    /// \return 1 if the key exists, otherwise 0
+    template<typename Key>
+    size_t count(const Key& key) const {
+        return _find(key, _hash(key)) != _capacity;
+    }
+
+    /// Finds several keys, prefetching the groups of a batch of keys before probing them, so the cache misses of
+    /// the lookups in a batch overlap
+    /// \param n the number of keys
+    /// \param key a function that returns the i-th key
+    /// \param found a function called with the index of each key and an iterator to its entry, or end()
+    template<typename KeyAt, typename Function>
+    void find_many(size_t n, KeyAt key, Function found) const {
+        size_t hashes[PREFETCH_BATCH];
+        for (size_t first = 0; first < n; first += PREFETCH_BATCH) {
+            auto last = std::min(n, first + PREFETCH_BATCH);
+            for (auto i = first; i < last and _capacity > 0; ++i) {
+                hashes[i - first] = _hash(key(i));
+                _prefetch(hashes[i - first]);
+            }//for
+
+            for (auto i = first; i < last; ++i)
+                found(i, const_iterator(this, _capacity == 0 ? 0 : _find(key(i), hashes[i - first])));
+        }//for
+    }
+
+    /// Gets the value of a given key, and inserts a default constructed value if the key does not exist
+    ValueType& operator [] (const KeyType& key) {
+        return try_emplace(key).first->second;
+    }
+
+    ValueType& operator [] (KeyType&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    /// Inserts a key with a value constructed from given arguments if the key does not exist
+    /// \return an iterator to the entry of the key, and true if the entry was inserted, otherwise false
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const KeyType& key, Args&&... args) {
+        auto hash = _hash(key);
+        auto slot = _find(key, hash);
+        if (slot != _capacity)
+            return {iterator(this, slot), false};
+
+        return {iterator(this, _insert(hash, key, std::forward<Args>(args)...)), true};
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(KeyType&& key, Args&&... args) {
+        auto hash = _hash(key);
+        auto slot = _find(key, hash);
+        if (slot != _capacity)
+            return {iterator(this, slot), false};
+
+        return {iterator(this, _insert(hash, std::move(key), std::forward<Args>(args)...)), true};
+    }
+
+    /// Inserts an entry constructed from given arguments if its key does not exist. The entry is constructed
+    /// before its key is looked up, and moved into its slot.
+    /// \return an iterator to the entry of the key, and true if the entry was inserted, otherwise false
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type entry(std::forward<Args>(args)...);
+        return try_emplace(std::move(entry.first), std::move(entry.second));
+    }
+
+    /// Inserts the entry of a node extracted from a table if its key does not exist
+    /// \return an iterator to the entry of the key, and true if the entry was inserted, otherwise false
+    std::pair<iterator, bool> insert(node_type&& node) {
+        if (node.empty())
+            return {end(), false};
+
+        return try_emplace(std::move(node.key()), std::move(node.mapped()));
+    }
+
+    /// Removes an entry from the table
+    /// \param pos the iterator to the entry
+    /// \return the node holding the entry
+    node_type extract(const_iterator pos) {
+        node_type node(std::move(_slots[pos._index]));
+        _destroy(pos._index);
+        return node;
+    }
+
+    /// Erases an entry
+    /// \param pos the iterator to the entry
+    /// \return the iterator to the next entry
+    iterator erase(const_iterator pos) {
+        _destroy(pos._index);
+        return iterator(this, pos._index + 1);
+    }
+
+    iterator erase(iterator pos) {
+        return erase(const_iterator(pos));
+    }
+
+    /// Erases the entry of a given key
+    /// \param key the given key
+    /// \return 1 if the key existed, otherwise 0
+    size_t erase(const KeyType& key) {
+        auto slot = _find(key, _hash(key));
+        if (slot == _capacity)
+            return 0;
+
+        _destroy(slot);
+        return 1;
+    }
+
+    /// Reserves slots for a given number of entries
+    /// \param size the given number of entries
+    void reserve(size_t size) {
+        if (size <= _size + _growth_left)
+            return;
+
+        auto capacity = std::max(_capacity, WIDTH);
+        while (capacity - capacity / 8 < size)
+            capacity *= 2;
+        _rehash(capacity);
+    }
+
+    void clear() {
+        for (size_t slot = 0; slot < _capacity; ++slot) {
+            if (_ctrl[slot] >= 0)
+                _slots[slot].~value_type();
+        }//for
+
+        if (_capacity > 0)
+            std::memset(_ctrl, FlatGroup::EMPTY, _capacity);
+        _size = 0;
+        _growth_left = _capacity - _capacity / 8;
+    }
+
+    void swap(FlatHashMap& table) noexcept {
+        std::swap(_ctrl, table._ctrl);
+        std::swap(_slots, table._slots);
+        std::swap(_capacity, table._capacity);
+        std::swap(_size, table._size);
+        std::swap(_growth_left, table._growth_left);
+        std::swap(_rehashes, table._rehashes);
+        std::swap(_hash, table._hash);
+        std::swap(_equal, table._equal);
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, _capacity);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, _capacity);
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    /// Iterators over the entry of a slot, which is empty if the slot is not used
+    /// \param slot the slot, which must be less than bucket_count()
+    const_local_iterator cbegin(size_t slot) const {
+        return _slots + slot;
+    }
+
+    const_local_iterator cend(size_t slot) const {
+        return _slots + slot + (_ctrl[slot] >= 0 ? 1 : 0);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /// Gets the number of slots
+    /// \return the number of slots
+    size_t bucket_count() const {
+        return _capacity;
+    }
+
+    /// Gets the number of times entries have been moved to new slots, either to grow the table or to reclaim
+    /// deleted slots
+    /// \return the number of rehashes
+    size_t rehashes() const {
+        return _rehashes;
+    }
+};
+
+/// The overhead of a flat table is a control byte per slot and the unused slots
+template<typename KeyType, typename ValueType, typename Hash, typename KeyEqual>
+size_t hash_table_overhead(const FlatHashMap<KeyType, ValueType, Hash, KeyEqual>& table) {
+    using Entry = typename FlatHashMap<KeyType, ValueType, Hash, KeyEqual>::value_type;
+    return table.bucket_count() + (table.bucket_count() - table.size()) * sizeof(Entry);
+}
+
+#endif //CRDTS_FLAT_HASH_MAP_HH
@@ -0,0 +1,178 @@
+#ifndef CRDTS_HLC_HH
+#define CRDTS_HLC_HH
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "serializer.hh"
+
+/// A hybrid logical clock (HLC) [1] stamps events with a physical time that is advanced past every stamp the
+/// replica has observed, so stamps follow real time between replicas whose clocks are roughly synchronized, and
+/// still order an event after every event it may depend on. A stamp packs 64 bits, from the most significant:
+/// 44 bits of physical time in milliseconds since the epoch, 10 bits of a logical counter that orders events in
+/// the same millisecond, and 10 bits of the identifier of the replica, which breaks ties between replicas. The
+/// logical counter overflows into the physical time, which then runs ahead of the wall clock for a moment.
+/// [1] Kulkarni SS, Demirbas M, Madappa D, Avva B, Leone M. (2014). Logical physical clocks. In International
+/// Conference on Principles of Distributed Systems (pp. 17-32). Springer, Cham.
+class HybridLogicalClock {
+public:
+    static const unsigned REPLICA_BITS = 10;
+    static const unsigned LOGICAL_BITS = 10;
+    static const uint64_t MAX_REPLICAS = uint64_t(1) << REPLICA_BITS;
+
+    /// Gets the time of the system clock in milliseconds since the epoch
+    static uint64_t system_time() {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    }
+
+private:
+    uint64_t _replica_id;
+    uint64_t _last{}; // The hybrid time of the latest stamp issued or observed, i.e., a stamp without replica bits
+    uint64_t (*_physical_time)();
+
+public:
+    /// Creates a clock of a replica
+    /// \param replica_id the identifier of the replica, which must be less than MAX_REPLICAS
+    /// \param physical_time the function that reads the physical time in milliseconds, e.g., a fake clock in tests
+    explicit HybridLogicalClock(uint64_t replica_id, uint64_t (*physical_time)() = system_time) :
+            _replica_id(replica_id), _physical_time(physical_time) {
+        if (replica_id >= MAX_REPLICAS)
+            throw std::out_of_range("replica id " + std::to_string(replica_id) + " exceeds the HLC replica bits");
+    }
+
+    /// Issues a stamp that is greater than every stamp issued or observed by the clock
+    /// \return the stamp
+    uint64_t now() {
+        _last = std::max(_physical_time() << LOGICAL_BITS, _last + 1);
+        return (_last << REPLICA_BITS) | _replica_id;
+    }
+
+    /// Advances the clock past a received stamp, so later stamps of the clock are greater than it
+    /// \param stamp the received stamp
+    void observe(uint64_t stamp) {
+        _last = std::max(_last, stamp >> REPLICA_BITS);
+    }
+
+    /// Gets the identifier of the replica
+    /// \return the replica id
+    uint64_t replica_id() const {
+        return _replica_id;
+    }
+};
+
+inline HybridLogicalClock*& _installed_clock() {
+    static thread_local HybridLogicalClock* clock = nullptr;
+    return clock;
+}
+
+/// Gets the hybrid logical clock of the calling thread, as the instrumentation sink is found (see
+/// set_instrumentation_sink). A thread that runs several replicas installs the clock of each before using it.
+/// There is no default clock: replicas that shared one would issue equal stamps for different writes.
+/// \return the installed clock
+/// \throw std::logic_error if no clock is installed
+inline HybridLogicalClock& hybrid_clock() {
+    auto installed = _installed_clock();
+    if (installed == nullptr)
+        throw std::logic_error("no hybrid logical clock is installed for the thread");
+
+    return *installed;
+}
+
+/// Installs a hybrid logical clock for the calling thread
+/// \param clock the clock, which must outlive its use, or nullptr to uninstall the clock
+inline void set_hybrid_clock(HybridLogicalClock* clock) {
+    _installed_clock() = clock;
+}
+
+/// HLCTimestamp is a stamp of a hybrid logical clock that can replace Timestamp in LWWRegister and Map. It takes
+/// 8 bytes instead of 24 and is compared as a single integer. Stamps are issued by the clock of the thread (see
+/// hybrid_clock), so the replica id of a stamp is the id of that clock, and taking a received stamp advances
+/// the clock. Each replica must install its own clock, with its replica id, in the threads that write or merge
+/// its objects. Stamps of different replicas then differ at least in their replica bits, so concurrent writes in
+/// the same millisecond are ordered by replica id, and every replica picks the same one.
+class HLCTimestamp {
+private:
+    uint64_t _stamp{};
+
+public:
+    /// Checks that a stamp can carry a given replica id. The stamp does not store the id: the replica id of a
+    /// stamp is the id of the clock that issues it, which must be the installed clock of the replica.
+    /// \param replica_id the replica id
+    /// \throw std::out_of_range if the replica id exceeds the replica bits of a stamp
+    void replica_id(uint64_t replica_id) {
+        if (replica_id >= HybridLogicalClock::MAX_REPLICAS)
+            throw std::out_of_range("replica id " + std::to_string(replica_id) + " exceeds the HLC replica bits");
+    }
+
+    /// Gets the id of the replica that issued the stamp
+    /// \return the replica id
+    uint64_t replica_id() const {
+        return _stamp & (HybridLogicalClock::MAX_REPLICAS - 1);
+    }
+
+    /// Replaces the stamp with a new stamp of the clock of the thread
+    /// \throw std::logic_error if no clock is installed
+    void update() {
+        _stamp = hybrid_clock().now();
+    }
+
+    /// Copies a given stamp, e.g., the stamp of a remote value that wins, and advances the clock past it
+    /// \param t the given stamp
+    /// \throw std::logic_error if no clock is installed
+    void copy(const HLCTimestamp& t) {
+        _stamp = t._stamp;
+        hybrid_clock().observe(_stamp);
+    }
+
+    /// Merges a received stamp with the stamp: keeps the greater one and advances the clock past both
+    /// \param t the received stamp
+    /// \throw std::logic_error if no clock is installed
+    void merge(const HLCTimestamp& t) {
+        _stamp = std::max(_stamp, t._stamp);
+        hybrid_clock().observe(_stamp);
+    }
+
+    /// Gets the physical time of the stamp
+    /// \return the time in milliseconds since the epoch
+    uint64_t physical_time() const {
+        return _stamp >> (HybridLogicalClock::REPLICA_BITS + HybridLogicalClock::LOGICAL_BITS);
+    }
+
+    /// Gets the logical counter of the stamp
+    /// \return the counter
+    uint64_t logical() const {
+        return (_stamp >> HybridLogicalClock::REPLICA_BITS) & ((uint64_t(1) << HybridLogicalClock::LOGICAL_BITS) - 1);
+    }
+
+    friend bool operator < (const HLCTimestamp& t1, const HLCTimestamp& t2) {
+        return t1._stamp < t2._stamp;
+    }
+
+    friend bool operator == (const HLCTimestamp& t1, const HLCTimestamp& t2) {
+        return t1._stamp == t2._stamp;
+    }
+
+    friend bool operator != (const HLCTimestamp& t1, const HLCTimestamp& t2) {
+        return t1._stamp != t2._stamp;
+    }
+
+    /// Writes the stamp to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _stamp);
+    }
+
+    /// Reads a stamp written by serialize from a stream
+    /// \param in the stream
+    /// \return true if the stamp was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        return Serializer<uint64_t>::read(in, _stamp);
+    }
+};
+
+#endif //CRDTS_HLC_HH
@@ -0,0 +1,159 @@
+#ifndef CRDTS_INSTRUMENTATION_HH
+#define CRDTS_INSTRUMENTATION_HH
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/// Instrumentation counts the work done by local operations and merges, and measures the time spent in
+/// each phase of a merge. CRDTs report to the instrumentation sink of the calling thread through the
+/// CRDTS_COUNT and CRDTS_PHASE macros, which compile to nothing unless CRDTS_INSTRUMENTATION is defined.
+/// The sink of a thread is a ThreadLocalCounters object unless another sink, e.g., an exporter to a
+/// metrics pipeline, is installed with set_instrumentation_sink.
+
+/// The counted events
+enum class Counter : size_t {
+    OPERATIONS,       // Local operations, e.g., a put of a Map is an add to its keys and an assign to a register
+    ELEMENTS_SCANNED, // Local or remote elements visited by a merge
+    ELEMENTS_ERASED,  // Local elements or registers erased by a merge
+    ELEMENTS_ADDED,   // Elements or registers added by a merge
+    STAMPS_UPDATED,   // Tags or register timestamps replaced with remote ones by a merge
+    HASH_PROBES,      // Hash table lookups of a merge
+    COUNT
+};
+
+/// The timed phases of a merge
+enum class Phase : size_t {
+    REMOVES,   // Applying remote removes to local elements
+    ADDS,      // Applying remote adds
+    VERSIONS,  // Joining causal contexts
+    REGISTERS, // Merging the registers of a Map
+    COUNT
+};
+
+/// Gets the name of a given counter
+/// \param counter the given counter
+/// \return the name of the counter
+inline const char* counter_name(Counter counter) {
+    static const char* names[] = {"operations", "elements_scanned", "elements_erased", "elements_added",
+                                  "stamps_updated", "hash_probes"};
+    return names[static_cast<size_t>(counter)];
+}
+
+/// Gets the name of a given phase
+/// \param phase the given phase
+/// \return the name of the phase
+inline const char* phase_name(Phase phase) {
+    static const char* names[] = {"removes", "adds", "versions", "registers"};
+    return names[static_cast<size_t>(phase)];
+}
+
+/// InstrumentationSink receives counted events and phase durations
+class InstrumentationSink {
+public:
+    virtual ~InstrumentationSink() = default;
+
+    /// Counts events
+    /// \param counter the counter of the events
+    /// \param n the number of events
+    virtual void count(Counter counter, uint64_t n) = 0;
+
+    /// Accounts the time spent in a phase
+    /// \param phase the phase
+    /// \param duration the time spent
+    virtual void elapsed(Phase phase, std::chrono::nanoseconds duration) = 0;
+};
+
+/// ThreadLocalCounters accumulates events and durations in memory; each thread has its own instance
+class ThreadLocalCounters : public InstrumentationSink {
+private:
+    std::array<uint64_t, static_cast<size_t>(Counter::COUNT)> _counts{};
+    std::array<std::chrono::nanoseconds, static_cast<size_t>(Phase::COUNT)> _durations{};
+
+public:
+    void count(Counter counter, uint64_t n) override {
+        _counts[static_cast<size_t>(counter)] += n;
+    }
+
+    void elapsed(Phase phase, std::chrono::nanoseconds duration) override {
+        _durations[static_cast<size_t>(phase)] += duration;
+    }
+
+    /// Gets the number of counted events of a given counter
+    /// \param counter the given counter
+    /// \return the number of events
+    uint64_t get(Counter counter) const {
+        return _counts[static_cast<size_t>(counter)];
+    }
+
+    /// Gets the time spent in a given phase
+    /// \param phase the given phase
+    /// \return the time spent
+    std::chrono::nanoseconds time(Phase phase) const {
+        return _durations[static_cast<size_t>(phase)];
+    }
+
+    /// Resets all counters and durations to zero
+    void reset() {
+        _counts.fill(0);
+        _durations.fill(std::chrono::nanoseconds::zero());
+    }
+};
+
+/// Gets the counters of the calling thread
+/// \return the counters
+inline ThreadLocalCounters& thread_counters() {
+    static thread_local ThreadLocalCounters counters;
+    return counters;
+}
+
+inline InstrumentationSink*& _installed_sink() {
+    static thread_local InstrumentationSink* sink = nullptr;
+    return sink;
+}
+
+/// Gets the sink of the calling thread
+/// \return the installed sink, or the counters of the thread if no sink is installed
+inline InstrumentationSink& instrumentation_sink() {
+    auto sink = _installed_sink();
+    return sink != nullptr ? *sink : thread_counters();
+}
+
+/// Installs a sink for the calling thread
+/// \param sink the sink, which must outlive its use, or nullptr to restore the counters of the thread
+inline void set_instrumentation_sink(InstrumentationSink* sink) {
+    _installed_sink() = sink;
+}
+
+/// PhaseTimer reports the time between its construction and destruction to the sink of the thread
+class PhaseTimer {
+private:
+    Phase _phase;
+    std::chrono::steady_clock::time_point _start;
+
+public:
+    explicit PhaseTimer(Phase phase) : _phase(phase), _start(std::chrono::steady_clock::now()) { }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator = (const PhaseTimer&) = delete;
+
+    ~PhaseTimer() {
+        instrumentation_sink().elapsed(_phase, std::chrono::steady_clock::now() - _start);
+    }
+};
+
+#define CRDTS_CONCAT_IMPL(a, b) a##b
+#define CRDTS_CONCAT(a, b) CRDTS_CONCAT_IMPL(a, b)
+
+#ifdef CRDTS_INSTRUMENTATION
+/// Counts n events of a counter, e.g., CRDTS_COUNT(HASH_PROBES, 1)
+#define CRDTS_COUNT(counter, n) instrumentation_sink().count(Counter::counter, n)
+/// Times the rest of the enclosing scope as a phase, e.g., CRDTS_PHASE(REMOVES)
+#define CRDTS_PHASE(phase) PhaseTimer CRDTS_CONCAT(crdts_phase_timer_, __LINE__)(Phase::phase)
+#else
+#define CRDTS_COUNT(counter, n) ((void) 0)
+#define CRDTS_PHASE(phase) ((void) 0)
+#endif
+
+#endif //CRDTS_INSTRUMENTATION_HH
@@ -0,0 +1,87 @@
+#ifndef CRDTS_MEMORY_USAGE_HH
+#define CRDTS_MEMORY_USAGE_HH
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+/// MemoryUsage reports the memory footprint of a CRDT object in bytes, broken down into
+/// - keys: the elements of a set or the keys of a map,
+/// - values: the values of registers, counters, or map entries,
+/// - metadata: the tags, timestamps, and causal contexts that make an object convergent, and
+/// - overhead: the buckets and node links of hash tables, and copies of keys kept in secondary tables.
+/// The footprint counts the contents of an object and the memory they allocate, not the fixed size of the
+/// containers holding them. Hash table overhead is an estimate based on the node layout of std::unordered_map,
+/// or the control bytes and unused slots of a FlatHashMap.
+struct MemoryUsage {
+    size_t keys{};
+    size_t values{};
+    size_t metadata{};
+    size_t overhead{};
+
+    /// Gets the total footprint
+    /// \return the sum of all categories
+    size_t total() const {
+        return keys + values + metadata + overhead;
+    }
+
+    /// Gets the footprint of data stored by clients, i.e., keys and values
+    /// \return the payload footprint
+    size_t payload() const {
+        return keys + values;
+    }
+
+    /// Gets the ratio of metadata and overhead to payload
+    /// \return the ratio, 0 if there is no payload
+    double metadata_ratio() const {
+        return payload() == 0 ? 0 : static_cast<double>(metadata + overhead) / payload();
+    }
+
+    MemoryUsage& operator += (const MemoryUsage& usage) {
+        keys += usage.keys;
+        values += usage.values;
+        metadata += usage.metadata;
+        overhead += usage.overhead;
+        return *this;
+    }
+};
+
+/// HeapSize computes the memory that a value allocates beyond its own size. Types without heap allocations
+/// use the primary template; specialize HeapSize for other types to account for their allocations.
+template<typename T, typename Enable = void>
+struct HeapSize {
+    /// Gets the allocated memory of a given value
+    /// \return the number of allocated bytes
+    static size_t of(const T&) {
+        return 0;
+    }
+};
+
+template<>
+struct HeapSize<std::string> {
+    static size_t of(const std::string& val) {
+        // Short strings are stored inside the string object
+        static const size_t inline_capacity = std::string().capacity();
+        return val.capacity() > inline_capacity ? val.capacity() + 1 : 0;
+    }
+};
+
+/// Gets the footprint of a given value, i.e., its size and allocated memory
+/// \param val the given value
+/// \return the number of bytes
+template<typename T>
+size_t footprint(const T& val) {
+    return sizeof(T) + HeapSize<T>::of(val);
+}
+
+/// Estimates the memory that a hash table uses in addition to its entries: the bucket array, and a
+/// next pointer and cached hash code in each node
+/// \param table the hash table
+/// \return the number of bytes
+template<typename KeyType, typename ValueType, typename Hash, typename Pred, typename Alloc>
+size_t hash_table_overhead(const std::unordered_map<KeyType, ValueType, Hash, Pred, Alloc>& table) {
+    return table.bucket_count() * sizeof(void*) + table.size() * (sizeof(void*) + sizeof(size_t));
+}
+
+#endif //CRDTS_MEMORY_USAGE_HH
@@ -0,0 +1,140 @@
+#ifndef CRDTS_REPLICAS_HH
+#define CRDTS_REPLICAS_HH
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include "causal_context.hh"
+#include "memory_usage.hh"
+
+/// InlineTags stores the tags of an element for a fixed number of replicas, whose identifiers are 0 to N - 1,
+/// in an array indexed by replica identifiers. A sequence number 0 marks a replica without a tag, as sequence
+/// numbers start from 1. It provides the part of the interface of std::unordered_map used for tags; iterators
+/// visit replicas with a tag.
+template<size_t N>
+class InlineTags {
+private:
+    std::array<uint64_t, N> _seq_numbers{};
+
+public:
+    using value_type = std::pair<uint64_t, uint64_t>;
+
+    class const_iterator {
+    private:
+        const InlineTags<N>* _tags;
+        size_t _index;
+        value_type _tag;
+
+        void _skip() {
+            while (_index < N and _tags->_seq_numbers[_index] == 0)
+                ++_index;
+            if (_index < N)
+                _tag = value_type(_index, _tags->_seq_numbers[_index]);
+        }
+
+    public:
+        const_iterator(const InlineTags<N>* tags, size_t index) : _tags(tags), _index(index) {
+            _skip();
+        }
+
+        const value_type& operator * () const {
+            return _tag;
+        }
+
+        const value_type* operator -> () const {
+            return &_tag;
+        }
+
+        const_iterator& operator ++ () {
+            ++_index;
+            _skip();
+            return *this;
+        }
+
+        friend bool operator == (const const_iterator& i1, const const_iterator& i2) {
+            return i1._index == i2._index;
+        }
+
+        friend bool operator != (const const_iterator& i1, const const_iterator& i2) {
+            return i1._index != i2._index;
+        }
+    };
+
+    /// Gets the sequence number of the tag of a given replica
+    /// \param replica_id the identifier of the replica, which must be less than N
+    /// \return the sequence number, 0 if the replica has no tag
+    uint64_t& operator [] (uint64_t replica_id) {
+        return _seq_numbers[replica_id];
+    }
+
+    const_iterator find(uint64_t replica_id) const {
+        return replica_id < N and _seq_numbers[replica_id] != 0 ? const_iterator(this, replica_id) : end();
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, N);
+    }
+
+    size_t size() const {
+        size_t result = 0;
+        for (auto seq_number: _seq_numbers)
+            result += seq_number != 0;
+
+        return result;
+    }
+
+    void clear() {
+        _seq_numbers.fill(0);
+    }
+};
+
+/// Gets the memory footprint of the tags of an element, all of which is metadata or hash table overhead
+/// \param tags the tags
+/// \return the memory usage
+inline MemoryUsage tags_memory_usage(const std::unordered_map<uint64_t, uint64_t>& tags) {
+    MemoryUsage usage;
+    usage.metadata = sizeof(tags) + tags.size() * sizeof(std::pair<const uint64_t, uint64_t>);
+    usage.overhead = hash_table_overhead(tags);
+    return usage;
+}
+
+template<size_t N>
+MemoryUsage tags_memory_usage(const InlineTags<N>& tags) {
+    MemoryUsage usage;
+    usage.metadata = sizeof(tags);
+    return usage;
+}
+
+/// ReplicaTraits selects how ORSet and Map store tags and causal contexts for a number of replicas N known at
+/// compile time. N = 0 means that the number of replicas is not known, and replica identifiers are arbitrary;
+/// tags and contexts are stored in hash tables. Otherwise, replica identifiers are 0 to N - 1, and tags and
+/// contexts are stored in arrays.
+template<size_t N>
+struct ReplicaTraits {
+    using Tags = InlineTags<N>;
+    using Context = FixedCausalContext<N>;
+
+    /// Checks if a replica identifier is valid
+    /// \param replica_id the replica identifier
+    /// \return true if the identifier is less than N, otherwise false
+    static bool valid(uint64_t replica_id) {
+        return replica_id < N;
+    }
+};
+
+template<>
+struct ReplicaTraits<0> {
+    using Tags = std::unordered_map<uint64_t, uint64_t>;
+    using Context = CausalContext;
+
+    static bool valid(uint64_t) {
+        return true;
+    }
+};
+
+#endif //CRDTS_REPLICAS_HH
@@ -0,0 +1,92 @@
+#include "segment_store.hh"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    void throw_errno(const std::string& what, const std::string& path) {
+        throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+    }
+
+    void write_all(int fd, const char* data, size_t size, const std::string& path) {
+        while (size > 0) {
+            auto written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno("cannot write", path);
+            }//if
+
+            data += written;
+            size -= written;
+        }//while
+    }
+}//namespace
+
+SegmentStore::SegmentStore(const std::string &path) : _path(path) {
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0)
+        throw_errno("cannot open", path);
+}
+
+SegmentStore::~SegmentStore() {
+    if (_fd >= 0) {
+        ::close(_fd);
+        ::unlink(_path.c_str());
+    }//if
+}
+
+uint64_t SegmentStore::append(const std::string &segment) {
+    auto offset = _size;
+    write_all(_fd, segment.data(), segment.size(), _path);
+    _size += segment.size();
+    return offset;
+}
+
+std::string SegmentStore::read(uint64_t offset, size_t size) const {
+    std::string result(size, '\0');
+    size_t done = 0;
+    while (done < size) {
+        auto n = ::pread(_fd, &result[done], size - done, offset + done);
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n < 0)
+            throw_errno("cannot read", _path);
+        if (n == 0)
+            throw std::runtime_error("cannot read " + _path + ": unexpected end of file");
+        done += n;
+    }//while
+
+    return result;
+}
+
+void SegmentStore::reset() {
+    if (::ftruncate(_fd, 0) != 0)
+        throw_errno("cannot truncate", _path);
+    if (::lseek(_fd, 0, SEEK_SET) < 0)
+        throw_errno("cannot seek", _path);
+    _size = 0;
+}
+
+void SegmentStore::replace(SegmentStore &other) {
+    if (::rename(other._path.c_str(), _path.c_str()) != 0)
+        throw_errno("cannot rename", other._path);
+
+    ::close(_fd);
+    _fd = other._fd;
+    _size = other._size;
+    other._fd = -1;
+    other._size = 0;
+}
+
+const std::string& SegmentStore::path() const {
+    return _path;
+}
+
+uint64_t SegmentStore::size() const {
+    return _size;
+}
@@ -0,0 +1,54 @@
+#ifndef CRDTS_SEGMENT_STORE_HH
+#define CRDTS_SEGMENT_STORE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// SegmentStore is an append-only file of segments, i.e., blocks of bytes that are appended at once and read
+/// back by their offsets, e.g., the cold entries of a TieredMap. The store is scratch space: the file is truncated
+/// when the store is opened and removed when it is destroyed, and appends are not synced.
+class SegmentStore {
+private:
+    int _fd{-1};
+    std::string _path;
+    uint64_t _size{};
+
+public:
+    /// Opens the store in a given file, the file is created or truncated
+    /// \param path the path of the file
+    explicit SegmentStore(const std::string& path);
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator = (const SegmentStore&) = delete;
+
+    /// Appends a segment to the file
+    /// \param segment the content of the segment
+    /// \return the offset of the segment in the file
+    uint64_t append(const std::string& segment);
+
+    /// Reads bytes that have been appended to the file
+    /// \param offset the offset of the first byte
+    /// \param size the number of bytes
+    /// \return the bytes
+    std::string read(uint64_t offset, size_t size) const;
+
+    /// Discards all segments
+    void reset();
+
+    /// Replaces the file of the store with the file of a given store, e.g., a compacted copy written next to it.
+    /// The file of the given store is renamed to the path of the store, and the given store is left closed.
+    /// \param other the given store
+    void replace(SegmentStore& other);
+
+    /// Gets the path of the file
+    /// \return the path
+    const std::string& path() const;
+
+    /// Gets the size of the file
+    /// \return the number of bytes appended since the store was opened or reset
+    uint64_t size() const;
+};
+
+#endif //CRDTS_SEGMENT_STORE_HH
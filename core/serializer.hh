@@ -0,0 +1,102 @@
+#ifndef CRDTS_SERIALIZER_HH
+#define CRDTS_SERIALIZER_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+/// Serializer converts a value to and from a binary stream. Arithmetic types are written in the
+/// native byte order of the host, and strings are prefixed with their 64 bit length. Specialize
+/// Serializer for other types to store them in a checkpoint or a write-ahead log.
+template<typename T, typename Enable = void>
+struct Serializer;
+
+/// Writes given bytes to the buffer of a stream. Unlike std::ostream::write, no sentry is constructed per call,
+/// which costs more than copying the few bytes of a number. A failed write sets the badbit of the stream.
+/// \param out the stream
+/// \param data the given bytes
+/// \param size the number of bytes
+inline void write_bytes(std::ostream& out, const char* data, size_t size) {
+    auto buffer = out.rdbuf();
+    if (!buffer or buffer->sputn(data, size) != static_cast<std::streamsize>(size))
+        out.setstate(std::ios::badbit);
+}
+
+template<typename T>
+struct Serializer<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    /// Writes a given value to a stream
+    /// \param out the stream
+    /// \param val the given value
+    static void write(std::ostream& out, const T& val) {
+        write_bytes(out, reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    /// Reads a value from a stream
+    /// \param in the stream
+    /// \param val the value read from the stream
+    /// \return true if the value was read successfully, otherwise false
+    static bool read(std::istream& in, T& val) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&val), sizeof(T)));
+    }
+};
+
+template<>
+struct Serializer<std::string> {
+    static void write(std::ostream& out, const std::string& val) {
+        Serializer<uint64_t>::write(out, val.size());
+        write_bytes(out, val.data(), val.size());
+    }
+
+    static bool read(std::istream& in, std::string& val) {
+        uint64_t size;
+        if (!Serializer<uint64_t>::read(in, size))
+            return false;
+
+        // The string grows as its bytes are read, so a corrupted size fails at the end of the stream rather than
+        // allocating as many bytes up front
+        const uint64_t chunk = 1 << 16;
+        val.clear();
+        while (val.size() < size) {
+            auto done = val.size();
+            auto n = std::min(chunk, size - done);
+            val.resize(done + n);
+            if (!in.read(&val[done], n))
+                return false;
+        }//while
+
+        return true;
+    }
+};
+
+/// StringBuffer is a stream buffer that appends the bytes written to an output stream to a string. Unlike
+/// std::ostringstream, the string is accessed without copying it, so the buffer can be reused to encode
+/// records one after another.
+class StringBuffer : public std::streambuf {
+private:
+    std::string _data;
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        _data.append(s, n);
+        return n;
+    }
+
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            _data.push_back(traits_type::to_char_type(c));
+        return c;
+    }
+
+public:
+    /// Gets the bytes written so far
+    /// \return the bytes
+    std::string& str() {
+        return _data;
+    }
+};
+
+#endif //CRDTS_SERIALIZER_HH
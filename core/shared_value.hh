@@ -0,0 +1,207 @@
+#ifndef CRDTS_SHARED_VALUE_HH
+#define CRDTS_SHARED_VALUE_HH
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include "memory_usage.hh"
+#include "serializer.hh"
+
+template<typename T, typename Hash>
+class ValuePool;
+
+/// SharedValue is an immutable, reference counted value. Copying a SharedValue shares the buffer of the value,
+/// so registers and maps that store SharedValue objects copy values by reference in merges, snapshots, and
+/// key_value_pairs. Use SharedValue<T> as the value type of a LWWRegister or Map to store large values, e.g.,
+/// Map<std::string, SharedValue<std::string>>, and a ValuePool to deduplicate equal values.
+///
+/// The memory usage of an object holding shared values counts the buffers that were not interned, e.g., values
+/// put by the application or read from a stream, so each copy sharing such a buffer counts it. The buffers of
+/// interned values are counted once by the memory usage of their pool, so objects only count their references.
+template<typename T>
+class SharedValue {
+    template<typename, typename> friend class ValuePool;
+
+private:
+    std::shared_ptr<const T> _ptr;
+    bool _pooled{}; // Whether the buffer is referenced by a pool, which counts its memory usage
+
+    SharedValue(std::shared_ptr<const T> ptr, bool pooled) : _ptr(std::move(ptr)), _pooled(pooled) { }
+
+public:
+    /// Creates an empty value
+    SharedValue() = default;
+
+    /// Creates a shared value holding a given value
+    /// \param value the given value
+    SharedValue(T value) : _ptr(std::make_shared<const T>(std::move(value))) { }
+
+    /// Creates a shared value that shares a given buffer
+    /// \param ptr the given buffer
+    explicit SharedValue(std::shared_ptr<const T> ptr) : _ptr(std::move(ptr)) { }
+
+    /// Gets the value
+    /// \return the value, or a default constructed value if the object is empty
+    const T& get() const {
+        static const T empty{};
+        return _ptr ? *_ptr : empty;
+    }
+
+    operator const T& () const {
+        return get();
+    }
+
+    /// Gets the shared buffer
+    /// \return the buffer, or nullptr if the object is empty
+    const std::shared_ptr<const T>& ptr() const {
+        return _ptr;
+    }
+
+    /// Checks whether the buffer was interned by a ValuePool
+    /// \return true if the buffer is referenced by a pool, otherwise false
+    bool pooled() const {
+        return _pooled;
+    }
+
+    /// Compares the equality of the values of two objects; objects sharing a buffer are equal without comparing
+    /// their values
+    /// \param v1 the first object
+    /// \param v2 the second object
+    /// \return true if the values are equal, otherwise false
+    friend bool operator == (const SharedValue<T>& v1, const SharedValue<T>& v2) {
+        return v1._ptr == v2._ptr or v1.get() == v2.get();
+    }
+
+    friend bool operator != (const SharedValue<T>& v1, const SharedValue<T>& v2) {
+        return !(v1 == v2);
+    }
+};
+
+/// ValuePool deduplicates values by their content: interning a value that is equal to a value interned earlier
+/// and still referenced returns a SharedValue sharing the buffer of the earlier value. The pool only keeps weak
+/// references, so a value is released when the last SharedValue referencing it is destroyed. A pool is not
+/// thread safe.
+template<typename T, typename Hash = std::hash<T>>
+class ValuePool {
+private:
+    std::unordered_multimap<size_t, std::weak_ptr<const T>> _values;
+    size_t _purge_threshold{64}; // The number of entries at which released values are purged
+
+    /// Finds a referenced value equal to a given value with a given hash code
+    /// \return the buffer of the value, or nullptr if no value is found
+    std::shared_ptr<const T> _find(size_t hash, const T& value) const {
+        auto range = _values.equal_range(hash);
+        for (auto entry = range.first; entry != range.second; ++entry) {
+            auto ptr = entry->second.lock();
+            if (ptr and *ptr == value)
+                return ptr;
+        }//for
+
+        return nullptr;
+    }
+
+    /// Adds a given buffer to the pool, and purges released values once the pool doubles in size
+    void _insert(size_t hash, const std::shared_ptr<const T>& ptr) {
+        if (_values.size() >= _purge_threshold) {
+            purge();
+            _purge_threshold = std::max<size_t>(64, 2 * _values.size());
+        }//if
+
+        _values.emplace(hash, ptr);
+    }
+
+public:
+    /// Interns a given value
+    /// \param value the given value
+    /// \return a shared value whose buffer is shared with equal interned values
+    SharedValue<T> intern(T value) {
+        auto hash = Hash()(value);
+        auto ptr = _find(hash, value);
+        if (!ptr) {
+            ptr = std::make_shared<const T>(std::move(value));
+            _insert(hash, ptr);
+        }//if
+
+        return SharedValue<T>(std::move(ptr), true);
+    }
+
+    /// Interns a given shared value, e.g., a value read from a stream or merged from another replica
+    /// \param value the given shared value
+    /// \return a shared value whose buffer is shared with equal interned values
+    SharedValue<T> intern(const SharedValue<T>& value) {
+        if (!value.ptr())
+            return value;
+
+        auto hash = Hash()(value.get());
+        auto ptr = _find(hash, value.get());
+        if (!ptr) {
+            ptr = value.ptr();
+            _insert(hash, ptr);
+        }//if
+
+        return SharedValue<T>(std::move(ptr), true);
+    }
+
+    /// Removes entries of values that are no longer referenced
+    void purge() {
+        for (auto entry = _values.begin(); entry != _values.end(); /* no increment here */) {
+            if (entry->second.expired())
+                entry = _values.erase(entry);
+            else
+                ++entry;
+        }//for
+    }
+
+    /// Gets the number of entries, including entries of released values that are not purged yet
+    /// \return the number of entries
+    size_t size() const {
+        return _values.size();
+    }
+
+    /// Gets the memory footprint of the values referenced through the pool, each buffer counted once, and of the
+    /// table of the pool
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        for (const auto& entry: _values) {
+            // The buffer holds the value and the reference counts
+            auto ptr = entry.second.lock();
+            if (ptr)
+                usage.values += footprint(*ptr) + 2 * sizeof(long);
+        }//for
+        usage.overhead = _values.bucket_count() * sizeof(void*) +
+                         _values.size() * (sizeof(void*) + sizeof(size_t) + sizeof(*_values.begin()));
+
+        return usage;
+    }
+};
+
+template<typename T>
+struct Serializer<SharedValue<T>> {
+    static void write(std::ostream& out, const SharedValue<T>& val) {
+        Serializer<T>::write(out, val.get());
+    }
+
+    static bool read(std::istream& in, SharedValue<T>& val) {
+        T value;
+        if (!Serializer<T>::read(in, value))
+            return false;
+
+        val = SharedValue<T>(std::move(value));
+        return true;
+    }
+};
+
+template<typename T>
+struct HeapSize<SharedValue<T>> {
+    /// The buffer of an interned value is counted by its pool, other buffers are counted by the values holding
+    /// them (see SharedValue), so the footprint of an object does not depend on other objects sharing its values
+    static size_t of(const SharedValue<T>& val) {
+        // The buffer holds the value and the reference counts
+        return val.ptr() and !val.pooled() ? footprint(val.get()) + 2 * sizeof(long) : 0;
+    }
+};
+
+#endif //CRDTS_SHARED_VALUE_HH
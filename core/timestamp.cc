@@ -1,4 +1,5 @@
 #include "timestamp.hh"
+#include "serializer.hh"
 
 void Timestamp::replica_id(uint64_t replica_id) {
     this->_replica_id = replica_id;
@@ -25,6 +26,11 @@ void Timestamp::update() {
     _uid = _replica_id;
 }
 
+void Timestamp::advance(uint64_t seq_number) {
+    if (_seq_number < seq_number)
+        _seq_number = seq_number;
+}
+
 uint64_t Timestamp::replica_id() const {
     return _replica_id;
 }
@@ -37,3 +43,15 @@ void Timestamp::copy(const Timestamp &t) {
 uint64_t Timestamp::sequence_number() {
     return _seq_number;
 }
+
+void Timestamp::serialize(std::ostream &out) const {
+    Serializer<uint64_t>::write(out, _seq_number);
+    Serializer<uint64_t>::write(out, _uid);
+    Serializer<uint64_t>::write(out, _replica_id);
+}
+
+bool Timestamp::deserialize(std::istream &in) {
+    return Serializer<uint64_t>::read(in, _seq_number) and
+           Serializer<uint64_t>::read(in, _uid) and
+           Serializer<uint64_t>::read(in, _replica_id);
+}
@@ -1,6 +1,7 @@
 #ifndef CRDTS_TIMESTAMP_HH
 #define CRDTS_TIMESTAMP_HH
 
+#include <istream>
 #include <ostream>
 
 /// Timestamp can represent a unique tag or a unique timestamp across
@@ -38,6 +39,10 @@ public:
     /// Update the timestamp by incrementing its sequence number
     void update();
 
+    /// Advances the sequence number to a given sequence number if it is smaller
+    /// \param seq_number the given sequence number
+    void advance(uint64_t seq_number);
+
     /// Gets the value of replica
     /// \return
     uint64_t replica_id() const;
@@ -50,6 +55,15 @@ public:
     /// Gets the sequence number
     /// \return the sequence number
     uint64_t sequence_number();
+
+    /// Writes the timestamp, including its replica id, to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const;
+
+    /// Reads a timestamp written by serialize from a stream
+    /// \param in the stream
+    /// \return true if the timestamp was read successfully, otherwise false
+    bool deserialize(std::istream& in);
 };
 
 #endif //CRDTS_TIMESTAMP_HH
@@ -0,0 +1,233 @@
+#include "wal.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // A record is stored as its payload size, checksum, and LSN followed by the payload
+    const size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
+    /// Mixes a given word of a payload into a given FNV-1a style hash
+    inline uint64_t mix(uint64_t hash, const char* word) {
+        const uint64_t prime = 1099511628211ull;
+        uint64_t val;
+        std::memcpy(&val, word, sizeof(val));
+        hash = (hash ^ val) * prime;
+        return hash ^ (hash >> 29);
+    }
+
+    /// Computes a FNV-1a style hash of the LSN and payload of a record. Four lanes hash interleaved words of the
+    /// payload, so the multiplications of a lane do not wait for those of the others.
+    uint32_t checksum(uint64_t lsn, const char* payload, size_t size) {
+        const uint64_t prime = 1099511628211ull;
+        const size_t word = sizeof(uint64_t);
+        uint64_t lanes[4];
+        for (uint64_t i = 0; i < 4; ++i)
+            lanes[i] = (14695981039346656037ull ^ lsn ^ i) * prime;
+        for (; size >= 4 * word; payload += 4 * word, size -= 4 * word) {
+            for (size_t i = 0; i < 4; ++i)
+                lanes[i] = mix(lanes[i], payload + i * word);
+        }//for
+        for (; size >= word; payload += word, size -= word)
+            lanes[0] = mix(lanes[0], payload);
+        for (; size > 0; ++payload, --size)
+            lanes[0] = (lanes[0] ^ static_cast<uint8_t>(*payload)) * prime;
+
+        uint64_t hash = lanes[0];
+        for (size_t i = 1; i < 4; ++i)
+            hash = (hash ^ lanes[i]) * prime;
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    void throw_errno(const std::string& what, const std::string& path) {
+        throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+    }
+
+    void write_all(int fd, const char* data, size_t size, const std::string& path) {
+        while (size > 0) {
+            auto written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno("cannot write", path);
+            }//if
+
+            data += written;
+            size -= written;
+        }//while
+    }
+
+    /// Calls a given function for each valid record in a given buffer
+    /// \return the size of the valid prefix of the buffer
+    size_t scan(const std::string& data, const std::function<void(uint64_t, const std::string&)>& fn) {
+        size_t pos = 0;
+        uint64_t last_lsn = 0;
+        while (data.size() - pos >= HEADER_SIZE) {
+            uint32_t size, sum;
+            uint64_t lsn;
+            std::memcpy(&size, data.data() + pos, sizeof(size));
+            std::memcpy(&sum, data.data() + pos + sizeof(size), sizeof(sum));
+            std::memcpy(&lsn, data.data() + pos + sizeof(size) + sizeof(sum), sizeof(lsn));
+
+            if (data.size() - pos - HEADER_SIZE < size)
+                break; // torn record
+            const char* payload = data.data() + pos + HEADER_SIZE;
+            if (lsn <= last_lsn or checksum(lsn, payload, size) != sum)
+                break; // corrupted record
+
+            if (fn)
+                fn(lsn, std::string(payload, size));
+            last_lsn = lsn;
+            pos += HEADER_SIZE + size;
+        }//while
+
+        return pos;
+    }
+}//namespace
+
+WriteAheadLog::WriteAheadLog(const std::string &path, const WALOptions &options) :
+        _path(path), _options(options) {
+    std::string data;
+    read_file(path, data);
+
+    // Find the last valid record and drop a torn tail
+    size_t valid = scan(data, [this](uint64_t lsn, const std::string&) { _next_lsn = lsn + 1; });
+
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (_fd < 0)
+        throw_errno("cannot open", path);
+    if (valid < data.size() and ::ftruncate(_fd, valid) != 0)
+        throw_errno("cannot truncate", path);
+    if (::lseek(_fd, valid, SEEK_SET) < 0)
+        throw_errno("cannot seek", path);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (_fd >= 0) {
+        try {
+            commit();
+        } catch (const std::exception&) {
+            // Buffered records are lost as if the process crashed
+        }//catch
+        ::close(_fd);
+    }//if
+}
+
+uint64_t WriteAheadLog::append(std::string_view payload) {
+    auto lsn = _next_lsn++;
+    auto size = static_cast<uint32_t>(payload.size());
+    auto sum = checksum(lsn, payload.data(), payload.size());
+
+    char header[HEADER_SIZE];
+    std::memcpy(header, &size, sizeof(size));
+    std::memcpy(header + sizeof(size), &sum, sizeof(sum));
+    std::memcpy(header + sizeof(size) + sizeof(sum), &lsn, sizeof(lsn));
+    _buffer.append(header, HEADER_SIZE);
+    _buffer.append(payload);
+
+    if (++_pending >= _options.group_size)
+        commit();
+
+    return lsn;
+}
+
+void WriteAheadLog::commit() {
+    if (_pending == 0)
+        return;
+
+    // The whole group is written with a single system call and synced once
+    write_all(_fd, _buffer.data(), _buffer.size(), _path);
+    if (_options.sync and ::fdatasync(_fd) != 0)
+        throw_errno("cannot sync", _path);
+
+    _buffer.clear();
+    _pending = 0;
+}
+
+void WriteAheadLog::replay(const std::function<void(uint64_t, const std::string &)> &fn) const {
+    std::string data;
+    if (read_file(_path, data))
+        scan(data, fn);
+}
+
+void WriteAheadLog::reset() {
+    _buffer.clear();
+    _pending = 0;
+
+    // The file keeps its size, so committing records over the discarded ones does not allocate blocks, and
+    // syncing them does not journal a change of its size. Replaying the file stops at the first discarded record
+    // following the new ones, since its LSN is smaller.
+    if (::lseek(_fd, 0, SEEK_SET) < 0)
+        throw_errno("cannot seek", _path);
+}
+
+void WriteAheadLog::advance(uint64_t lsn) {
+    _next_lsn = std::max(_next_lsn, lsn + 1);
+}
+
+uint64_t WriteAheadLog::last_lsn() const {
+    return _next_lsn - 1;
+}
+
+const WALOptions& WriteAheadLog::options() const {
+    return _options;
+}
+
+void write_file_atomically(const std::string &path, const std::string &content) {
+    auto tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw_errno("cannot open", tmp_path);
+
+    try {
+        write_all(fd, content.data(), content.size(), tmp_path);
+        if (::fsync(fd) != 0)
+            throw_errno("cannot sync", tmp_path);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }//catch
+    ::close(fd);
+
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0)
+        throw_errno("cannot rename", tmp_path);
+
+    // The rename is durable once the directory is synced; otherwise a crash may bring the old file back
+    auto slash = path.rfind('/');
+    auto dir = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : path.substr(0, slash);
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0)
+        throw_errno("cannot open", dir);
+    if (::fsync(dir_fd) != 0) {
+        auto error = errno;
+        ::close(dir_fd);
+        errno = error;
+        throw_errno("cannot sync", dir);
+    }//if
+    ::close(dir_fd);
+}
+
+bool read_file(const std::string &path, std::string &content) {
+    content.clear();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    char buf[1 << 16];
+    while (true) {
+        auto n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 and errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        content.append(buf, n);
+    }//while
+    ::close(fd);
+
+    return true;
+}
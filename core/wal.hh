@@ -0,0 +1,97 @@
+#ifndef CRDTS_WAL_HH
+#define CRDTS_WAL_HH
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/// Options of a write-ahead log
+struct WALOptions {
+    /// The number of appended records that are written to the file with a single write and fsync.
+    /// Records appended after the last commit are lost on a crash.
+    size_t group_size = 64;
+
+    /// Whether a commit calls fsync. Without fsync, committed records survive a process crash but
+    /// not a power failure.
+    bool sync = true;
+
+    /// The number of records appended between two consecutive checkpoints of a durable CRDT. A checkpoint writes
+    /// the elements changed by these records, so the log of a recovered CRDT holds at most as many records.
+    size_t checkpoint_interval = 4096;
+
+    /// The number of records per element of a durable CRDT that its checkpoint deltas hold before a checkpoint
+    /// writes the whole state instead of a delta. Recovery applies at most as many records of deltas per element.
+    size_t deltas_ratio = 8;
+};
+
+/// WriteAheadLog is an append-only file of records. Appended records are buffered in memory and
+/// written to the file in groups, so a single write and fsync commits a group of records (group commit).
+/// Every record carries a log sequence number (LSN) and a checksum. On opening a log, a torn record at
+/// the end of the file (e.g., a record partially written before a crash) and the records following it
+/// are discarded.
+class WriteAheadLog {
+private:
+    int _fd{-1};
+    std::string _path;
+    WALOptions _options;
+    std::string _buffer; // Encoded records that are not committed yet
+    size_t _pending{}; // The number of records in the buffer
+    uint64_t _next_lsn{1};
+
+public:
+    /// Opens the log stored in a given file, the file is created if it does not exist
+    /// \param path the path of the file
+    /// \param options the options of the log
+    WriteAheadLog(const std::string& path, const WALOptions& options);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator = (const WriteAheadLog&) = delete;
+
+    /// Appends a record to the log. The record is committed once the number of buffered records
+    /// reaches the group size.
+    /// \param payload the content of the record
+    /// \return the LSN of the record
+    uint64_t append(std::string_view payload);
+
+    /// Writes buffered records to the file and, if enabled, waits for them to reach the disk
+    void commit();
+
+    /// Calls a given function for each record stored in the file in the order of their LSNs
+    /// \param fn the function taking the LSN and payload of a record
+    void replay(const std::function<void(uint64_t, const std::string&)>& fn) const;
+
+    /// Discards all records in the log, LSNs continue to increase. Records appended from now on overwrite the
+    /// discarded ones in the file, so the discarded records following the last committed record remain in the file
+    /// until it is opened again, and all of them are replayed if the log is replayed before any commit, e.g., after
+    /// a crash. They must be covered by a checkpoint that stores their last LSN and skips them on replay.
+    void reset();
+
+    /// Ensures that LSNs of records appended from now on are greater than a given LSN, e.g., the LSN
+    /// covered by a checkpoint of a log that was reset after the checkpoint
+    /// \param lsn the given LSN
+    void advance(uint64_t lsn);
+
+    /// Gets the LSN of the last appended record
+    /// \return the LSN of the last appended record, 0 if no record has been appended
+    uint64_t last_lsn() const;
+
+    /// Gets the options of the log
+    /// \return the options
+    const WALOptions& options() const;
+};
+
+/// Atomically replaces the content of a given file: the content is written to a temporary file that is
+/// synced and renamed to the given file, and the directory of the file is synced.
+/// \param path the path of the file
+/// \param content the new content
+void write_file_atomically(const std::string& path, const std::string& content);
+
+/// Reads the content of a given file
+/// \param path the path of the file
+/// \param content the content of the file
+/// \return true if the file exists and was read, otherwise false
+bool read_file(const std::string& path, std::string& content);
+
+#endif //CRDTS_WAL_HH
@@ -0,0 +1,281 @@
+#ifndef CRDTS_SIM_CLUSTER_HH
+#define CRDTS_SIM_CLUSTER_HH
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../statebased/lwwregister.hh"
+#include "../statebased/map.hh"
+#include "../statebased/orset.hh"
+#include "network.hh"
+#include "workload.hh"
+
+/// Converts a key of a workload to a key of a CRDT
+template<typename KeyType>
+KeyType workload_key(size_t key) {
+    return static_cast<KeyType>(key);
+}
+
+template<>
+inline std::string workload_key<std::string>(size_t key) {
+    return "key" + std::to_string(key);
+}
+
+/// ReplicaOps adapts a CRDT type to the simulator: it creates replicas, applies the operations of a workload,
+/// reads states received from other replicas, and compares the states of replicas
+template<typename CRDT>
+struct ReplicaOps;
+
+template<typename ValueType, size_t Replicas, typename Containers>
+struct ReplicaOps<ORSet<ValueType, Replicas, Containers>> {
+    using Set = ORSet<ValueType, Replicas, Containers>;
+
+    static Set create(uint64_t replica_id) {
+        return Set(replica_id);
+    }
+
+    static void apply(Set& set, const Operation& op) {
+        if (op.remove)
+            set.remove(workload_key<ValueType>(op.key));
+        else
+            set.add(workload_key<ValueType>(op.key));
+    }
+
+    static bool read(std::istream& in, Set& set) {
+        return set.deserialize(in);
+    }
+
+    static bool equal(const Set& s1, const Set& s2) {
+        return s1.elements() == s2.elements();
+    }
+};
+
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp>
+struct ReplicaOps<Map<KeyType, ValueType, Replicas, Containers, Stamp>> {
+    using Type = Map<KeyType, ValueType, Replicas, Containers, Stamp>;
+
+    static Type create(uint64_t replica_id) {
+        return Type(replica_id);
+    }
+
+    static void apply(Type& map, const Operation& op) {
+        if (op.remove)
+            map.remove(workload_key<KeyType>(op.key));
+        else
+            map.put(workload_key<KeyType>(op.key), static_cast<ValueType>(op.value));
+    }
+
+    static bool read(std::istream& in, Type& map) {
+        return map.deserialize(in);
+    }
+
+    static bool equal(Type& m1, Type& m2) {
+        return m1.key_value_pairs() == m2.key_value_pairs();
+    }
+};
+
+template<typename ValueType, typename Stamp>
+struct ReplicaOps<LWWRegister<ValueType, Stamp>> {
+    using Register = LWWRegister<ValueType, Stamp>;
+
+    static Register create(uint64_t replica_id) {
+        Register reg;
+        reg.replica_id(replica_id);
+        return reg;
+    }
+
+    /// A register has no keys, so every operation assigns a value
+    static void apply(Register& reg, const Operation& op) {
+        reg.assign(static_cast<ValueType>(op.value));
+    }
+
+    static bool read(std::istream& in, Register& reg) {
+        return reg.deserialize(in);
+    }
+
+    static bool equal(const Register& r1, const Register& r2) {
+        return r1.value() == r2.value();
+    }
+};
+
+/// The ways replicas exchange states
+enum class SyncMode {
+    PUSH,      // A replica sends its state to its peers
+    PUSH_PULL  // A replica also replies with its state to each state it receives
+};
+
+/// The parameters of a simulation
+struct ClusterConfig {
+    size_t replicas{8};
+    uint64_t gossip_interval{1}; // The number of ticks between two gossip rounds
+    uint64_t max_ticks{10000};   // The number of ticks after which a simulation stops if replicas do not converge
+    uint64_t seed{1};
+    SyncMode mode{SyncMode::PUSH};
+    WorkloadConfig workload;
+    NetworkConfig network;
+};
+
+/// The results of a simulation
+struct ClusterReport {
+    bool converged{};
+    uint64_t convergence_ticks{}; // The number of ticks from the last operation until all replicas are equal
+    uint64_t operations{};
+    uint64_t messages{};
+    uint64_t lost_messages{};
+    uint64_t bytes{};
+    uint64_t merges{};
+    // The time each replica spent merging received states, excluding reading them
+    std::vector<std::chrono::nanoseconds> merge_time;
+    std::vector<MemoryUsage> memory; // The memory usage of each replica at the end of the simulation
+
+    /// Writes the report in a human readable form to a stream
+    /// \param out the stream
+    void print(std::ostream& out) const {
+        size_t total = 0, max = 0;
+        for (const auto& usage: memory) {
+            total += usage.total();
+            max = std::max(max, usage.total());
+        }//for
+
+        std::chrono::nanoseconds total_merge{}, max_merge{};
+        for (auto time: merge_time) {
+            total_merge += time;
+            max_merge = std::max(max_merge, time);
+        }//for
+
+        out << "converged:         " << (converged ? "yes" : "no") << "\n"
+            << "convergence ticks: " << convergence_ticks << "\n"
+            << "operations:        " << operations << "\n"
+            << "messages:          " << messages << " (" << lost_messages << " lost)\n"
+            << "bytes exchanged:   " << bytes << "\n"
+            << "merges:            " << merges << "\n"
+            << "merge cpu:         " << total_merge.count() / 1e6 << " ms total\n"
+            << "merge cpu per replica: " << (merge_time.empty() ? 0 : total_merge.count() / 1e6 / merge_time.size())
+            << " ms average, " << max_merge.count() / 1e6 << " ms max\n"
+            << "memory per replica: " << (memory.empty() ? 0 : total / memory.size()) << " bytes average, "
+            << max << " bytes max\n";
+    }
+};
+
+/// Cluster simulates a group of replicas of a CRDT in a single process. In each tick, replicas perform the
+/// operations of a workload, receive the states delivered by the network and merge them, and, every
+/// gossip_interval ticks, send their states to the peers selected by a topology. After the workload ends,
+/// the simulation runs until all replicas are equal. All random choices are drawn from a generator seeded
+/// with the seed of the configuration, so a simulation is deterministic; only merge times vary between runs.
+template<typename CRDT>
+class Cluster {
+private:
+    using Ops = ReplicaOps<CRDT>;
+
+    ClusterConfig _config;
+    std::unique_ptr<Topology> _topology;
+    std::mt19937_64 _rand;
+    Network _network;
+    Workload _workload;
+    std::vector<CRDT> _replicas;
+    uint64_t _now{};
+    ClusterReport _report;
+
+    /// Sends the state of a replica to given peers
+    void _send(size_t replica, const std::vector<size_t>& peers, bool reply) {
+        if (peers.empty())
+            return;
+
+        std::ostringstream out;
+        _replicas[replica].serialize(out);
+        auto payload = out.str();
+        for (auto peer: peers)
+            _network.send(replica, peer, payload, reply, _now, _rand);
+    }
+
+    /// Merges the states delivered in the current tick
+    void _deliver() {
+        for (const auto& message: _network.deliver(_now)) {
+            auto remote = Ops::create(message.from);
+            std::istringstream in(message.payload);
+            if (!Ops::read(in, remote))
+                continue;
+
+            auto start = std::chrono::steady_clock::now();
+            _replicas[message.to].merge(std::move(remote));
+            _report.merge_time[message.to] += std::chrono::steady_clock::now() - start;
+            ++_report.merges;
+
+            if (_config.mode == SyncMode::PUSH_PULL and !message.reply)
+                _send(message.to, {message.from}, true);
+        }//for
+    }
+
+    /// Checks if all replicas are equal
+    bool _converged() {
+        for (size_t r = 1; r < _replicas.size(); ++r) {
+            if (!Ops::equal(_replicas[0], _replicas[r]))
+                return false;
+        }//for
+
+        return true;
+    }
+
+public:
+    /// Creates a cluster
+    /// \param config the parameters of the simulation
+    /// \param topology the topology of gossip
+    Cluster(const ClusterConfig& config, std::unique_ptr<Topology> topology) :
+            _config(config), _topology(std::move(topology)), _rand(config.seed), _network(config.network),
+            _workload(config.workload) {
+        for (size_t r = 0; r < config.replicas; ++r)
+            _replicas.push_back(Ops::create(r));
+        _report.merge_time.resize(config.replicas);
+    }
+
+    /// Runs the simulation
+    /// \return the results of the simulation
+    ClusterReport run() {
+        auto write_ticks = _config.workload.write_ticks;
+        for (_now = 0; _now < _config.max_ticks; ++_now) {
+            if (_now < write_ticks) {
+                for (auto& replica: _replicas) {
+                    for (const auto& op: _workload.operations(_rand)) {
+                        Ops::apply(replica, op);
+                        ++_report.operations;
+                    }//for
+                }//for
+            }//if
+
+            _deliver();
+            if (_now % _config.gossip_interval == 0) {
+                for (size_t r = 0; r < _replicas.size(); ++r)
+                    _send(r, _topology->peers(r, _replicas.size(), _rand), false);
+            }//if
+
+            if (_now + 1 >= write_ticks and _converged()) {
+                _report.converged = true;
+                _report.convergence_ticks = _now + 1 - write_ticks;
+                break;
+            }//if
+        }//for
+
+        _report.messages = _network.sent();
+        _report.lost_messages = _network.lost();
+        _report.bytes = _network.bytes();
+        for (const auto& replica: _replicas)
+            _report.memory.push_back(replica.memory_usage());
+
+        return _report;
+    }
+
+    /// Gets a replica
+    /// \param replica the index of the replica
+    /// \return the replica
+    CRDT& replica(size_t replica) {
+        return _replicas[replica];
+    }
+};
+
+#endif //CRDTS_SIM_CLUSTER_HH
@@ -0,0 +1,162 @@
+#ifndef CRDTS_SIM_NETWORK_HH
+#define CRDTS_SIM_NETWORK_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// A state sent from a replica to another replica
+struct Message {
+    uint64_t deliver_at; // The tick at which the message is delivered
+    uint64_t seq_number; // The order of sending, which orders messages delivered at the same tick
+    size_t from;
+    size_t to;
+    bool reply;          // True if the message replies to a received state in push-pull gossip
+    std::string payload; // The serialized state
+};
+
+/// The parameters of the in-memory transport
+struct NetworkConfig {
+    double loss{0};       // The probability that a message is dropped
+    uint64_t min_delay{1}; // The minimum number of ticks between sending and delivering a message
+    uint64_t max_delay{1}; // The maximum number of ticks between sending and delivering a message
+};
+
+/// Network is an in-memory transport that drops and delays messages at random. Messages are delivered in the
+/// order of their delivery ticks, and messages delivered at the same tick in the order they were sent, so a
+/// simulation is deterministic for a given seed.
+class Network {
+private:
+    struct Later {
+        bool operator () (const Message& m1, const Message& m2) const {
+            return m1.deliver_at > m2.deliver_at or (m1.deliver_at == m2.deliver_at and m1.seq_number > m2.seq_number);
+        }
+    };
+
+    NetworkConfig _config;
+    std::priority_queue<Message, std::vector<Message>, Later> _in_flight;
+    uint64_t _sent{};
+    uint64_t _lost{};
+    uint64_t _bytes{};
+
+public:
+    explicit Network(const NetworkConfig& config) : _config(config) { }
+
+    /// Sends a state to a replica
+    /// \param from the sending replica
+    /// \param to the receiving replica
+    /// \param payload the serialized state
+    /// \param reply true if the message replies to a received state
+    /// \param now the current tick
+    /// \param rand the random number generator
+    void send(size_t from, size_t to, const std::string& payload, bool reply, uint64_t now, std::mt19937_64& rand) {
+        ++_sent;
+        _bytes += payload.size();
+        if (std::bernoulli_distribution(_config.loss)(rand)) {
+            ++_lost;
+            return;
+        }//if
+
+        auto delay = std::uniform_int_distribution<uint64_t>(_config.min_delay, _config.max_delay)(rand);
+        _in_flight.push(Message{now + delay, _sent, from, to, reply, payload});
+    }
+
+    /// Removes the messages that are delivered at or before a given tick
+    /// \param now the given tick
+    /// \return the messages in delivery order
+    std::vector<Message> deliver(uint64_t now) {
+        std::vector<Message> result;
+        while (!_in_flight.empty() and _in_flight.top().deliver_at <= now) {
+            result.push_back(_in_flight.top());
+            _in_flight.pop();
+        }//while
+
+        return result;
+    }
+
+    /// Gets the number of sent messages, including lost ones
+    uint64_t sent() const {
+        return _sent;
+    }
+
+    /// Gets the number of lost messages
+    uint64_t lost() const {
+        return _lost;
+    }
+
+    /// Gets the number of sent bytes, including the bytes of lost messages
+    uint64_t bytes() const {
+        return _bytes;
+    }
+};
+
+/// Topology selects the peers to which a replica gossips its state
+class Topology {
+public:
+    virtual ~Topology() = default;
+
+    /// Gets the peers of a replica in a gossip round
+    /// \param replica the replica
+    /// \param replicas the number of replicas
+    /// \param rand the random number generator
+    /// \return the peers
+    virtual std::vector<size_t> peers(size_t replica, size_t replicas, std::mt19937_64& rand) const = 0;
+};
+
+/// Every replica gossips to all other replicas
+class FullMesh : public Topology {
+public:
+    std::vector<size_t> peers(size_t replica, size_t replicas, std::mt19937_64&) const override {
+        std::vector<size_t> result;
+        for (size_t peer = 0; peer < replicas; ++peer) {
+            if (peer != replica)
+                result.push_back(peer);
+        }//for
+
+        return result;
+    }
+};
+
+/// Every replica gossips to the next replica on a ring
+class Ring : public Topology {
+public:
+    std::vector<size_t> peers(size_t replica, size_t replicas, std::mt19937_64&) const override {
+        if (replicas < 2)
+            return {};
+
+        return {(replica + 1) % replicas};
+    }
+};
+
+/// Every replica gossips to a number of peers drawn at random in each round
+class RandomPeers : public Topology {
+private:
+    size_t _fanout;
+
+public:
+    explicit RandomPeers(size_t fanout) : _fanout(fanout) { }
+
+    std::vector<size_t> peers(size_t replica, size_t replicas, std::mt19937_64& rand) const override {
+        std::vector<size_t> candidates;
+        for (size_t peer = 0; peer < replicas; ++peer) {
+            if (peer != replica)
+                candidates.push_back(peer);
+        }//for
+
+        // A partial Fisher-Yates shuffle draws distinct peers
+        auto fanout = std::min(_fanout, candidates.size());
+        for (size_t i = 0; i < fanout; ++i) {
+            auto j = std::uniform_int_distribution<size_t>(i, candidates.size() - 1)(rand);
+            std::swap(candidates[i], candidates[j]);
+        }//for
+        candidates.resize(fanout);
+
+        return candidates;
+    }
+};
+
+#endif //CRDTS_SIM_NETWORK_HH
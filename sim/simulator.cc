@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include "cluster.hh"
+
+/// crdts_sim runs a simulation of a cluster and prints its report. Options are given as --name=value:
+///   --type=orset|map|register   the replicated CRDT (default map)
+///   --replicas=N                the number of replicas (default 8)
+///   --topology=mesh|ring|random the gossip topology (default random)
+///   --fanout=K                  the number of peers of the random topology (default 2)
+///   --mode=push|push-pull       the sync mode (default push)
+///   --gossip-interval=T         the ticks between gossip rounds (default 1)
+///   --write-rate=R              the operations per replica and tick (default 1)
+///   --write-ticks=T             the ticks in which replicas perform operations (default 100)
+///   --keys=K                    the number of distinct keys (default 1000)
+///   --skew=S                    the Zipf exponent of keys, 0 for uniform keys (default 0)
+///   --remove-ratio=P            the fraction of removes (default 0.1)
+///   --loss=P                    the probability of losing a message (default 0)
+///   --min-delay=T, --max-delay=T the delay of messages in ticks (default 1)
+///   --max-ticks=T               the ticks after which the simulation stops (default 10000)
+///   --seed=S                    the seed of random choices (default 1)
+/// Unknown options, values that are not numbers, negative or out of range numbers, zero replicas, keys, or gossip
+/// intervals, and ratios or probabilities outside [0, 1] are rejected.
+
+namespace {
+    /// Gets the value of an option of the form --name=value
+    /// \return true if the argument is the option, otherwise false
+    bool option(const char* arg, const char* name, std::string& value) {
+        auto length = std::strlen(name);
+        if (std::strncmp(arg, "--", 2) != 0 or std::strncmp(arg + 2, name, length) != 0 or arg[2 + length] != '=')
+            return false;
+
+        value = arg + 3 + length;
+        return true;
+    }
+
+    /// Parses the value of an option that must lie in a range
+    /// \param value the value of the option
+    /// \param min the smallest valid value
+    /// \param max the largest valid value
+    /// \param result the parsed value
+    /// \return true if the value is a number in [min, max], otherwise false
+    bool bounded(const std::string& value, double min, double max, double& result) {
+        char* end = nullptr;
+        result = std::strtod(value.c_str(), &end);
+        return !value.empty() and *end == '\0' and result >= min and result <= max;
+    }
+
+    /// Parses the value of an option that must be an unsigned integer
+    /// \param value the value of the option
+    /// \param min the smallest valid value
+    /// \param result the parsed value
+    /// \return true if the value is an integer in [min, the largest value of the result type], otherwise false
+    template<typename T>
+    bool integer(const std::string& value, T min, T& result) {
+        if (value.empty() or !std::isdigit(static_cast<unsigned char>(value[0])))
+            return false;
+
+        char* end = nullptr;
+        errno = 0;
+        auto parsed = std::strtoull(value.c_str(), &end, 10);
+        if (*end != '\0' or errno == ERANGE or parsed < min or parsed > std::numeric_limits<T>::max())
+            return false;
+
+        result = static_cast<T>(parsed);
+        return true;
+    }
+
+    template<typename CRDT>
+    ClusterReport simulate(const ClusterConfig& config, std::unique_ptr<Topology> topology) {
+        Cluster<CRDT> cluster(config, std::move(topology));
+        return cluster.run();
+    }
+}//namespace
+
+int main(int argc, char* argv[]) {
+    ClusterConfig config;
+    std::string type = "map", topology = "random", mode = "push";
+    size_t fanout = 2;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        bool valid = true;
+        if (option(argv[i], "type", value))
+            type = value;
+        else if (option(argv[i], "replicas", value))
+            valid = integer<size_t>(value, 1, config.replicas);
+        else if (option(argv[i], "topology", value))
+            topology = value;
+        else if (option(argv[i], "fanout", value))
+            valid = integer<size_t>(value, 0, fanout);
+        else if (option(argv[i], "mode", value))
+            mode = value;
+        else if (option(argv[i], "gossip-interval", value))
+            valid = integer<uint64_t>(value, 1, config.gossip_interval);
+        else if (option(argv[i], "write-rate", value))
+            valid = bounded(value, 0, std::numeric_limits<uint32_t>::max(), config.workload.write_rate);
+        else if (option(argv[i], "write-ticks", value))
+            valid = integer<uint64_t>(value, 0, config.workload.write_ticks);
+        else if (option(argv[i], "keys", value))
+            valid = integer<size_t>(value, 1, config.workload.keys);
+        else if (option(argv[i], "skew", value))
+            valid = bounded(value, 0, std::numeric_limits<double>::max(), config.workload.skew);
+        else if (option(argv[i], "remove-ratio", value))
+            valid = bounded(value, 0, 1, config.workload.remove_ratio);
+        else if (option(argv[i], "loss", value))
+            valid = bounded(value, 0, 1, config.network.loss);
+        else if (option(argv[i], "min-delay", value))
+            valid = integer<uint64_t>(value, 0, config.network.min_delay);
+        else if (option(argv[i], "max-delay", value))
+            valid = integer<uint64_t>(value, 0, config.network.max_delay);
+        else if (option(argv[i], "max-ticks", value))
+            valid = integer<uint64_t>(value, 0, config.max_ticks);
+        else if (option(argv[i], "seed", value))
+            valid = integer<uint64_t>(value, 0, config.seed);
+        else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }//else
+
+        if (!valid) {
+            std::cerr << "invalid option " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }//if
+    }//for
+    config.network.max_delay = std::max(config.network.min_delay, config.network.max_delay);
+
+    std::unique_ptr<Topology> peers;
+    if (topology == "mesh")
+        peers.reset(new FullMesh());
+    else if (topology == "ring")
+        peers.reset(new Ring());
+    else if (topology == "random")
+        peers.reset(new RandomPeers(fanout));
+    else {
+        std::cerr << "unknown topology " << topology << "\n";
+        return EXIT_FAILURE;
+    }//else
+
+    if (mode == "push" or mode == "push-pull") {
+        config.mode = mode == "push" ? SyncMode::PUSH : SyncMode::PUSH_PULL;
+    }//if
+    else {
+        std::cerr << "unknown mode " << mode << "\n";
+        return EXIT_FAILURE;
+    }//else
+
+    ClusterReport report;
+    if (type == "orset")
+        report = simulate<ORSet<std::string>>(config, std::move(peers));
+    else if (type == "map")
+        report = simulate<Map<std::string, uint64_t>>(config, std::move(peers));
+    else if (type == "register")
+        report = simulate<LWWRegister<uint64_t>>(config, std::move(peers));
+    else {
+        std::cerr << "unknown type " << type << "\n";
+        return EXIT_FAILURE;
+    }//else
+
+    report.print(std::cout);
+    return report.converged ? EXIT_SUCCESS : EXIT_FAILURE;
+}
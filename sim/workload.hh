@@ -0,0 +1,89 @@
+#ifndef CRDTS_SIM_WORKLOAD_HH
+#define CRDTS_SIM_WORKLOAD_HH
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/// The parameters of the operations that each replica performs
+struct WorkloadConfig {
+    double write_rate{1};     // The expected number of operations per replica and tick
+    uint64_t write_ticks{100}; // The number of ticks in which replicas perform operations
+    size_t keys{1000};         // The number of distinct keys or elements
+    double skew{0};            // The exponent of the Zipf distribution of keys, 0 for uniform keys
+    double remove_ratio{0.1};  // The fraction of operations that remove a key
+};
+
+/// KeyGenerator draws keys 0 to keys - 1 from a Zipf distribution, where key k has a probability proportional
+/// to 1 / (k + 1)^skew
+class KeyGenerator {
+private:
+    std::vector<double> _cdf;
+
+public:
+    KeyGenerator(size_t keys, double skew) : _cdf(std::max<size_t>(keys, 1)) {
+        double sum = 0;
+        for (size_t k = 0; k < _cdf.size(); ++k) {
+            sum += 1 / std::pow(k + 1, skew);
+            _cdf[k] = sum;
+        }//for
+
+        for (auto& p: _cdf)
+            p /= sum;
+    }
+
+    /// Draws a key
+    /// \param rand the random number generator
+    /// \return the key
+    size_t next(std::mt19937_64& rand) const {
+        auto p = std::uniform_real_distribution<double>(0, 1)(rand);
+        auto key = std::lower_bound(_cdf.begin(), _cdf.end(), p) - _cdf.begin();
+        return std::min<size_t>(key, _cdf.size() - 1);
+    }
+};
+
+/// An operation of a workload: a write of a value to a key, or a remove of a key
+struct Operation {
+    bool remove;
+    size_t key;
+    uint64_t value;
+};
+
+/// Workload draws the operations that a replica performs in a tick
+class Workload {
+private:
+    WorkloadConfig _config;
+    KeyGenerator _keys;
+
+public:
+    explicit Workload(const WorkloadConfig& config) : _config(config), _keys(config.keys, config.skew) { }
+
+    /// Draws the operations of a replica in a tick; the number of operations is the integer part of the write
+    /// rate, plus one with the probability of its fractional part
+    /// \param rand the random number generator
+    /// \return the operations
+    std::vector<Operation> operations(std::mt19937_64& rand) const {
+        auto count = static_cast<size_t>(_config.write_rate);
+        if (std::bernoulli_distribution(_config.write_rate - count)(rand))
+            ++count;
+
+        std::vector<Operation> result;
+        for (size_t i = 0; i < count; ++i) {
+            Operation op;
+            op.remove = std::bernoulli_distribution(_config.remove_ratio)(rand);
+            op.key = _keys.next(rand);
+            op.value = rand();
+            result.push_back(op);
+        }//for
+
+        return result;
+    }
+
+    const WorkloadConfig& config() const {
+        return _config;
+    }
+};
+
+#endif //CRDTS_SIM_WORKLOAD_HH
@@ -0,0 +1,480 @@
+#ifndef CRDTS_DURABLE_HH
+#define CRDTS_DURABLE_HH
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../core/flat_hash_map.hh"
+#include "../core/serializer.hh"
+#include "../core/wal.hh"
+#include "orset.hh"
+#include "map.hh"
+
+/// DurableState keeps a CRDT durable using a write-ahead log and checkpoints stored next to each other
+/// (`<path>.wal`, `<path>.deltas`, and `<path>.checkpoint`). Each local mutation of an element is appended to the
+/// log with the tag it was assigned. Every WALOptions::checkpoint_interval records, an incremental checkpoint
+/// appends a delta to the log of deltas and truncates the log. A delta holds the causal context of the CRDT and,
+/// for each element changed since the previous checkpoint, its last record and the last remove before it, which
+/// restore the element as replaying all its records would. Once the deltas hold WALOptions::deltas_ratio records
+/// per element of the state, the whole state is written to the base checkpoint instead, which truncates both logs.
+/// A checkpoint thus costs a constant amortized time per record however large the state is, and recovery reads the
+/// base, at most deltas_ratio records per element of deltas, and at most checkpoint_interval records of the log.
+/// Each checkpoint stores the LSN of the last record it covers, so records and deltas that survive a crash between
+/// writing a checkpoint and truncating the logs are not applied twice.
+class DurableState {
+private:
+    // A record kept for the next delta: its end in the window, the end of its element, and whether it is a remove
+    struct WindowRecord {
+        size_t end;
+        size_t element_end;
+        bool removes;
+    };
+
+    std::string _base_path;
+    WriteAheadLog _wal;
+    WriteAheadLog _deltas;
+    size_t _base_size{}; // The size of the base checkpoint
+    size_t _deltas_records{}; // The number of records in the deltas written since the base checkpoint
+    bool _merged{}; // Whether a merge changed the state since the last checkpoint, see merged
+    StringBuffer _window; // The records appended since the last checkpoint, each record is encoded at its end
+    std::ostream _record{&_window};
+    size_t _record_begin{}; // The beginning of the record being encoded in the window
+    size_t _element_end{}; // The end of the element in the record being encoded
+    std::vector<WindowRecord> _window_records;
+    StringBuffer _delta; // Reused to encode deltas
+    std::ostream _delta_out{&_delta};
+    FlatHashMap<std::string_view, bool> _removes_kept; // Reused by _write_window, see there
+
+    /// Writes the records of the window that restore the changed elements to the delta being encoded. An
+    /// element is restored by its last record, preceded by its last remove if the last record adds it again, which
+    /// discards the tags of the element before the window. Records are compared by the encoding of their elements,
+    /// starting after the operation.
+    /// \return the number of records written
+    size_t _write_window() {
+        // For each element, whether a remove of the element is kept or not needed
+        _removes_kept.clear();
+        _removes_kept.reserve(_window_records.size());
+        std::vector<size_t> kept;
+        for (auto i = _window_records.size(); i-- > 0;) {
+            auto begin = i == 0 ? 0 : _window_records[i - 1].end;
+            const auto& record = _window_records[i];
+            std::string_view element(_window.str().data() + begin + 1, record.element_end - begin - 1);
+            auto elem = _removes_kept.try_emplace(element, record.removes);
+            if (elem.second) {
+                kept.push_back(i);
+            }//if
+            else if (record.removes and !elem.first->second) {
+                kept.push_back(i);
+                elem.first->second = true;
+            }//else if
+        }//for
+
+        Serializer<uint64_t>::write(_delta_out, kept.size());
+        for (auto i = kept.size(); i-- > 0;) {
+            auto begin = kept[i] == 0 ? 0 : _window_records[kept[i] - 1].end;
+            auto size = _window_records[kept[i]].end - begin;
+            Serializer<uint64_t>::write(_delta_out, size);
+            write_bytes(_delta_out, _window.str().data() + begin, size);
+        }//for
+        return kept.size();
+    }
+
+    /// Truncates the log and empties the window after a checkpoint
+    void _reset_log() {
+        _wal.reset();
+        _window.str().clear();
+        _window_records.clear();
+    }
+
+public:
+    /// Opens the logs and checkpoint stored at a given path
+    /// \param path the path prefix of the logs and checkpoint files
+    /// \param options the options of the logs
+    DurableState(const std::string& path, const WALOptions& options) :
+            _base_path(path + ".checkpoint"), _wal(path + ".wal", options), _deltas(path + ".deltas", options) { }
+
+    /// Loads the base checkpoint into a given state, applies the deltas written after it, and replays the records
+    /// appended after the last delta
+    /// \param state the given state
+    /// \param apply the function applying the payload of a record to the state, and returning the end of its
+    /// element in the payload and whether it removes the element
+    /// \param read_context the function reading the context written by the write_context function given to log
+    template<typename State, typename Apply, typename ReadContext>
+    void recover(State& state, Apply apply, ReadContext read_context) {
+        uint64_t checkpoint_lsn = 0;
+        std::string data;
+        if (read_file(_base_path, data)) {
+            std::istringstream in(data);
+            if (!Serializer<uint64_t>::read(in, checkpoint_lsn) or !state.deserialize(in))
+                throw std::runtime_error("corrupted checkpoint " + _base_path);
+            _base_size = data.size();
+        }//if
+
+        _deltas.replay([&](uint64_t, const std::string& payload) {
+            std::istringstream in(payload);
+            uint64_t lsn, records;
+            if (!Serializer<uint64_t>::read(in, lsn))
+                throw std::runtime_error("corrupted checkpoint delta");
+            if (lsn <= checkpoint_lsn)
+                return; // covered by the base
+            if (!read_context(in) or !Serializer<uint64_t>::read(in, records))
+                throw std::runtime_error("corrupted checkpoint delta");
+
+            std::string record;
+            for (uint64_t i = 0; i < records; ++i) {
+                if (!Serializer<std::string>::read(in, record))
+                    throw std::runtime_error("corrupted checkpoint delta");
+                std::istringstream record_in(record);
+                apply(record_in);
+            }//for
+            _deltas_records += records;
+            checkpoint_lsn = lsn;
+        });
+
+        _wal.replay([&](uint64_t lsn, const std::string& payload) {
+            if (lsn > checkpoint_lsn) {
+                std::istringstream in(payload);
+                auto element = apply(in);
+                auto begin = _window.str().size();
+                _window.str().append(payload);
+                _window_records.push_back({_window.str().size(), begin + element.first, element.second});
+            }//if
+        });
+        _wal.advance(checkpoint_lsn);
+    }
+
+    /// Starts encoding a new record of a mutation of a given element, with the operation and the element
+    /// \param op the operation of the mutation
+    /// \param e the given element
+    /// \return the stream to which the rest of the record is written
+    template<typename Element>
+    std::ostream& record(uint8_t op, const Element& e) {
+        // Drops a record left by a mutation that threw before logging it
+        _record_begin = _window_records.empty() ? 0 : _window_records.back().end;
+        _window.str().resize(_record_begin);
+        Serializer<uint8_t>::write(_record, op);
+        Serializer<Element>::write(_record, e);
+        _element_end = _window.str().size();
+        return _record;
+    }
+
+    /// Appends the record encoded since the last call of record to the log, and checkpoints a given state if the
+    /// checkpoint interval is reached. The record that reaches the interval is covered by the checkpoint and is not
+    /// appended to the log, nor are the records of the log that are not committed yet.
+    /// \param state the given state, to which the mutation described by the record is already applied
+    /// \param removes whether the record removes its element
+    /// \param write_context the function writing the causal context of the state to a stream
+    template<typename State, typename WriteContext>
+    void log(const State& state, bool removes, WriteContext write_context) {
+        const auto& window = _window.str();
+        _window_records.push_back({window.size(), _element_end, removes});
+        if (_window_records.size() < _wal.options().checkpoint_interval)
+            _wal.append(std::string_view(window.data() + _record_begin, window.size() - _record_begin));
+        else
+            checkpoint(state, write_context);
+    }
+
+    /// Marks the state as changed by a merge. Merges are not logged and may change any element, so the next
+    /// checkpoint writes the whole state.
+    void merged() {
+        _merged = true;
+    }
+
+    /// Appends the elements changed since the last checkpoint to the deltas and truncates the log, or writes the
+    /// whole state if the deltas reached WALOptions::deltas_ratio records per element or the state was merged
+    /// \param state the given state
+    /// \param write_context the function writing the causal context of the state to a stream
+    template<typename State, typename WriteContext>
+    void checkpoint(const State& state, WriteContext write_context) {
+        if (_merged or _deltas_records >= _wal.options().deltas_ratio * state.size()) {
+            checkpoint(state);
+            return;
+        }//if
+
+        _delta.str().clear();
+        Serializer<uint64_t>::write(_delta_out, _wal.last_lsn());
+        write_context(_delta_out);
+        _deltas_records += _write_window();
+        _deltas.append(_delta.str());
+        _deltas.commit();
+        _reset_log();
+    }
+
+    /// Writes a given state to the base checkpoint and truncates the deltas and the log
+    /// \param state the given state
+    template<typename State>
+    void checkpoint(const State& state) {
+        StringBuffer buffer;
+        buffer.str().reserve(_base_size);
+        std::ostream out(&buffer);
+        Serializer<uint64_t>::write(out, _wal.last_lsn());
+        state.serialize(out);
+        write_file_atomically(_base_path, buffer.str());
+        _base_size = buffer.str().size();
+
+        _deltas.reset();
+        _deltas_records = 0;
+        _merged = false;
+        _reset_log();
+    }
+
+    /// Commits records appended to the log
+    void sync() {
+        _wal.commit();
+    }
+};
+
+/// DurableORSet is an ORSet whose local add and remove operations survive crashes. Merged remote
+/// operations become durable with the next checkpoint; they can be received again from other replicas.
+template<typename ValueType>
+class DurableORSet {
+private:
+    enum Operation : uint8_t { ADD, REMOVE };
+
+    ORSet<ValueType> _set;
+    DurableState _durable;
+
+    /// Applies a logged operation to the set
+    /// \param in the stream of the logged record
+    /// \return the end of the element in the record and whether the element was removed
+    std::pair<size_t, bool> _apply(std::istream& in) {
+        uint8_t op;
+        ValueType e;
+        if (!Serializer<uint8_t>::read(in, op) or !Serializer<ValueType>::read(in, e))
+            throw std::runtime_error("corrupted log record");
+        size_t element_end = in.tellg();
+
+        if (op == ADD) {
+            // Restore the tag assigned to the element when it was added
+            uint64_t replica_id, seq_number;
+            if (!Serializer<uint64_t>::read(in, replica_id) or !Serializer<uint64_t>::read(in, seq_number))
+                throw std::runtime_error("corrupted log record");
+
+            _set._context.add(replica_id, seq_number);
+            _set._elements[e][replica_id] = seq_number;
+        }//if
+        else {
+            _set._elements.erase(e);
+        }//else
+        return {element_end, op == REMOVE};
+    }
+
+    /// Writes the causal context of the set to a stream
+    /// \param out the stream
+    void _write_context(std::ostream& out) const {
+        _set._context.serialize(out);
+    }
+
+public:
+    /// Creates a durable ORSet recovered from the logs and checkpoint stored at a given path
+    /// \param replica_id the given replica id
+    /// \param path the path prefix of the logs and checkpoint files
+    /// \param options the options of the logs
+    DurableORSet(uint64_t replica_id, const std::string& path, const WALOptions& options = WALOptions()) :
+            _set(replica_id), _durable(path, options) {
+        _durable.recover(_set, [this](std::istream& in) { return _apply(in); },
+                         [this](std::istream& in) { return _set._context.deserialize(in); });
+        if (_set.replica_id() != replica_id)
+            throw std::runtime_error("the checkpoint at " + path + " belongs to another replica");
+    }
+
+    /// Adds a given element to the set
+    /// \param e the given element
+    void add(const ValueType& e) {
+        _set.add(e);
+
+        auto& out = _durable.record(ADD, e);
+        Serializer<uint64_t>::write(out, _set._replica_id);
+        Serializer<uint64_t>::write(out, _set._context.max(_set._replica_id));
+        _durable.log(_set, false, [this](std::ostream& out) { _write_context(out); });
+    }
+
+    /// Removes a given element from the set
+    /// \param e the given element
+    /// \return true if the given element existed and was removed, otherwise false
+    bool remove(const ValueType& e) {
+        if (!_set.remove(e))
+            return false;
+
+        _durable.record(REMOVE, e);
+        _durable.log(_set, true, [this](std::ostream& out) { _write_context(out); });
+        return true;
+    }
+
+    /// Check if the given element exists in the set
+    /// \param e the given element
+    /// \return true if the given element exists, otherwise false
+    bool contains(const ValueType& e) {
+        return _set.contains(e);
+    }
+
+    /// Merges the local set with a given remote set
+    /// \param remote_set the given remote set
+    void merge(const ORSet<ValueType>& remote_set) {
+        _set.merge(remote_set);
+        _durable.merged();
+    }
+
+    /// Commits logged operations, operations are durable once this function returns
+    void sync() {
+        _durable.sync();
+    }
+
+    /// Writes the current state, including merged remote operations, to the checkpoint
+    void checkpoint() {
+        _durable.checkpoint(_set);
+    }
+
+    /// Gets the underlying set, e.g., to send it to other replicas
+    /// \return the set
+    const ORSet<ValueType>& state() const {
+        return _set;
+    }
+};
+
+/// DurableMap is a Map whose local put and remove operations survive crashes. Merged remote
+/// operations become durable with the next checkpoint; they can be received again from other replicas.
+template<typename KeyType, typename ValueType>
+class DurableMap {
+private:
+    enum Operation : uint8_t { PUT, REMOVE };
+
+    Map<KeyType, ValueType> _map;
+    DurableState _durable;
+
+    /// Applies a logged operation to the map
+    /// \param in the stream of the logged record
+    /// \return the end of the key in the record and whether the key was removed
+    std::pair<size_t, bool> _apply(std::istream& in) {
+        uint8_t op;
+        KeyType k;
+        if (!Serializer<uint8_t>::read(in, op) or !Serializer<KeyType>::read(in, k))
+            throw std::runtime_error("corrupted log record");
+        size_t key_end = in.tellg();
+
+        if (op == PUT) {
+            // Restore the tag of the key and the timestamp of the register assigned by put
+            ValueType val;
+            uint64_t replica_id, seq_number;
+            Timestamp timestamp;
+            if (!Serializer<ValueType>::read(in, val) or !Serializer<uint64_t>::read(in, replica_id) or
+                !Serializer<uint64_t>::read(in, seq_number) or !timestamp.deserialize(in))
+                throw std::runtime_error("corrupted log record");
+
+            _map._keys._context.add(replica_id, seq_number);
+            _map._keys._elements[k][replica_id] = seq_number;
+
+            auto& reg = _map._registers[k];
+            reg._timestamp = timestamp;
+            reg._value = val;
+            _map._clock = std::max(_map._clock, timestamp.sequence_number());
+        }//if
+        else {
+            _map.remove(k);
+        }//else
+        return {key_end, op == REMOVE};
+    }
+
+    /// Writes the causal context of the keys and the clock of the registers to a stream. A delta may not hold the
+    /// put that issued the greatest timestamp, if its key was removed afterwards.
+    /// \param out the stream
+    void _write_context(std::ostream& out) const {
+        _map._keys._context.serialize(out);
+        Serializer<uint64_t>::write(out, _map._clock);
+    }
+
+    /// Reads the causal context of the keys and the clock of the registers written by _write_context
+    /// \param in the stream
+    /// \return true if the context was read successfully, otherwise false
+    bool _read_context(std::istream& in) {
+        uint64_t clock;
+        if (!_map._keys._context.deserialize(in) or !Serializer<uint64_t>::read(in, clock))
+            return false;
+        _map._clock = std::max(_map._clock, clock);
+        return true;
+    }
+
+public:
+    /// Creates a durable map recovered from the logs and checkpoint stored at a given path
+    /// \param replica_id the given replica id
+    /// \param path the path prefix of the logs and checkpoint files
+    /// \param options the options of the logs
+    DurableMap(uint64_t replica_id, const std::string& path, const WALOptions& options = WALOptions()) :
+            _map(replica_id), _durable(path, options) {
+        _durable.recover(_map, [this](std::istream& in) { return _apply(in); },
+                         [this](std::istream& in) { return _read_context(in); });
+        if (_map.replica_id() != replica_id)
+            throw std::runtime_error("the checkpoint at " + path + " belongs to another replica");
+    }
+
+    /// Puts a given key and value pair to the map
+    /// \param key the given key
+    /// \param val the given value
+    void put(KeyType key, ValueType val) {
+        // The key is encoded first, so it is moved to the map, and the value is moved rather than copied over the
+        // old value, as Map::put does
+        _map._check_clock();
+        auto& out = _durable.record(PUT, key);
+        _map._keys.add(key);
+        auto& reg = _map._register(std::move(key));
+        _map._assign(reg, std::move(val));
+
+        Serializer<ValueType>::write(out, reg._value);
+        Serializer<uint64_t>::write(out, _map._keys._replica_id);
+        Serializer<uint64_t>::write(out, _map._keys._context.max(_map._keys._replica_id));
+        reg._timestamp.serialize(out);
+        _durable.log(_map, false, [this](std::ostream& out) { _write_context(out); });
+    }
+
+    /// Gets the value of a given key
+    /// \param key the given key
+    /// \return the value
+    ValueType get(const KeyType& key) {
+        return _map.get(key);
+    }
+
+    /// Removes a given key from the map
+    /// \param key the given key
+    void remove(const KeyType& key) {
+        _map.remove(key);
+
+        _durable.record(REMOVE, key);
+        _durable.log(_map, true, [this](std::ostream& out) { _write_context(out); });
+    }
+
+    /// Checks the existence of a given key
+    /// \param key the given key
+    /// \return true if the key exists, otherwise false
+    bool contains(const KeyType& key) {
+        return _map.contains(key);
+    }
+
+    /// Merges a given map with the local map
+    /// \param map the given map
+    void merge(const Map<KeyType, ValueType>& map) {
+        _map.merge(map);
+        _durable.merged();
+    }
+
+    /// Commits logged operations, operations are durable once this function returns
+    void sync() {
+        _durable.sync();
+    }
+
+    /// Writes the current state, including merged remote operations, to the checkpoint
+    void checkpoint() {
+        _durable.checkpoint(_map);
+    }
+
+    /// Gets the underlying map, e.g., to send it to other replicas
+    /// \return the map
+    const Map<KeyType, ValueType>& state() const {
+        return _map;
+    }
+};
+
+#endif //CRDTS_DURABLE_HH
@@ -1,25 +1,22 @@
-#ifndef CRDTS_LWWREGISTER_HH
-#define CRDTS_LWWREGISTER_HH
+#ifndef CRDTS_GCOUNTER_HH
+#define CRDTS_GCOUNTER_HH
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include "../core/containers.hh"
+#include "../core/instrumentation.hh"
+#include "../core/memory_usage.hh"
+#include "../core/serializer.hh"
 
-template<typename ValueType>
+/// GCounter is a grow-only counter. Containers selects the hash table of the counts of replicas (see ORSet).
+template<typename ValueType, typename Containers = StdContainers>
 class GCounter {
-    static_assert(std::is_base_of<char, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<short, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<int, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<long, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<long long, ValueType>::value, "ValueType must extend integer");
-
-    static_assert(std::is_base_of<unsigned char, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<unsigned short, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<unsigned int, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<unsigned long, ValueType>::value, "ValueType must extend integer");
-    static_assert(std::is_base_of<unsigned long long, ValueType>::value, "ValueType must extend integer");
+    static_assert(std::is_integral<ValueType>::value, "ValueType must be an integer");
 
 private:
-    uint64_t _replica_id;
-    std::unordered_map<uint64_t, ValueType> _counters;
+    uint64_t _replica_id{};
+    typename Containers::template Map<uint64_t, ValueType> _counters;
 
 public:
     /// Sets the replica id of the register.
@@ -42,23 +39,77 @@ public:
     }
 
     /// Increment the counter
-    void increment() const {
+    void increment() {
+        CRDTS_COUNT(OPERATIONS, 1);
         _counters[_replica_id]++;
     }
 
     /// Merges a given register with the local register
     /// \param reg the given register
-    void merge(const GCounter<ValueType>& cnt) {
+    void merge(const GCounter<ValueType, Containers>& cnt) {
         // TODO: What happens to new replica ids?
         for (auto c: cnt._counters)
             this->_counters[c.first] = std::max(this->_counters[c.first], c.second);
     }
 
+    /// Gets a delta of the counter, i.e., a counter holding only the count of the local replica. The local count
+    /// is all that local increments change, so merging the delta has the same effect as merging the counter.
+    /// \return the delta
+    GCounter<ValueType, Containers> delta() const {
+        GCounter<ValueType, Containers> result;
+        result._replica_id = _replica_id;
+        auto count = _counters.find(_replica_id);
+        if (count != _counters.end())
+            result._counters[_replica_id] = count->second;
+
+        return result;
+    }
+
     /// Gets the replica id
     /// \return the replica's id
     uint64_t replica_id() const {
         return this->_replica_id;
     }
+
+    /// Gets the memory footprint of the counter: the count of each replica and replica ids as metadata
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.values = _counters.size() * sizeof(ValueType);
+        usage.metadata = _counters.size() * sizeof(uint64_t);
+        usage.overhead = hash_table_overhead(_counters);
+        return usage;
+    }
+
+    /// Writes the count of each replica to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _counters.size());
+        for (const auto& count: _counters) {
+            Serializer<uint64_t>::write(out, count.first);
+            Serializer<ValueType>::write(out, count.second);
+        }//for
+    }
+
+    /// Replaces the counts of replicas with those written by serialize to a stream; the replica id is not changed
+    /// \param in the stream
+    /// \return true if the counts were read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        uint64_t counters;
+        if (!Serializer<uint64_t>::read(in, counters))
+            return false;
+
+        typename Containers::template Map<uint64_t, ValueType> counters_read;
+        for (uint64_t i = 0; i < counters; ++i) {
+            uint64_t replica_id;
+            if (!Serializer<uint64_t>::read(in, replica_id) or
+                !Serializer<ValueType>::read(in, counters_read[replica_id]))
+                return false;
+        }//for
+
+        this->_counters.swap(counters_read);
+        return true;
+    }
 };
 
-#endif //CRDTS_LWWREGISTER_HH
+#endif //CRDTS_GCOUNTER_HH
@@ -0,0 +1,240 @@
+#ifndef CRDTS_INCREMENTAL_MERGE_HH
+#define CRDTS_INCREMENTAL_MERGE_HH
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "orset.hh"
+#include "map.hh"
+
+/// IncrementalMerge is a resumable merge that is performed in bounded steps, so merging a large remote
+/// state can be interleaved with other work on the same thread. A merge goes through the same phases as
+/// `merge`: it applies remote removes by scanning local elements, applies remote adds by scanning remote
+/// elements, and finally merges causal contexts.
+///
+/// A merge does not copy the remote object: it reads the remote object, which must outlive the merge and must
+/// not change until the merge is done, or takes an rvalue over. So creating a merge only reserves the local tables,
+/// and the first step starts without copying the remote object. Each element is merged atomically within a step, so between steps an element is
+/// either in its local or its merged state. Causal contexts are merged in the last step, so a partially merged
+/// object never claims to have observed remote operations that it has not applied. Local operations may be called
+/// between steps; merging other remote objects into the local object must wait until the merge is done.
+///
+/// Creating a merge reserves room in the local tables for every remote element, so no step rehashes them, and a
+/// step costs about as many lookups as the elements it merges; a step may finish the bucket of local elements it
+/// has started. Only local operations between steps can still grow the tables.
+class IncrementalMerge {
+private:
+    // The number of elements merged between two checks of the clock in step_for
+    static const size_t CLOCK_CHECK_INTERVAL = 32;
+
+public:
+    virtual ~IncrementalMerge() = default;
+
+    /// Merges at most a given number of elements
+    /// \param max_elements the given number of elements
+    /// \return true if the merge is done, otherwise false
+    virtual bool step(size_t max_elements) = 0;
+
+    /// Merges elements until the merge is done or a given time budget is spent
+    /// \param budget the given time budget
+    /// \return true if the merge is done, otherwise false
+    bool step_for(std::chrono::microseconds budget) {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        while (!step(CLOCK_CHECK_INTERVAL)) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+        }//while
+
+        return true;
+    }
+
+    /// Finishes the merge without a bound
+    void finish() {
+        while (!step(SIZE_MAX)) { }
+    }
+};
+
+/// ORSetMerge incrementally merges a remote set with a local set
+template<typename ValueType, size_t Replicas = 0, typename Containers = StdContainers>
+class ORSetMerge : public IncrementalMerge {
+protected:
+    enum Phase { REMOVES, ADDS, VERSIONS, DONE };
+
+    ORSet<ValueType, Replicas, Containers>& _local;
+    std::unique_ptr<const ORSet<ValueType, Replicas, Containers>> _owned; // The remote set if it was moved in
+    const ORSet<ValueType, Replicas, Containers>& _remote;
+    Phase _phase{REMOVES};
+
+    // Local elements are scanned bucket by bucket, since iterators are invalidated by local operations
+    // called between steps. If local operations rehash the local set, the scan restarts; applying a remote
+    // remove is idempotent, and rehashes are rare as the number of buckets grows geometrically.
+    size_t _bucket{};
+    size_t _bucket_count{};
+    size_t _layout{};
+    typename ORSet<ValueType, Replicas, Containers>::Elements::const_iterator _remote_elem;
+
+    /// Called for each local element removed in applying remote removes
+    virtual void _removed(const ValueType&) { }
+
+    /// Called for each remote element after applying its remote adds
+    virtual void _added(const ValueType&) { }
+
+    /// Applies remote removes to at most a given number of local elements
+    /// \return the number of scanned elements and empty buckets
+    size_t _step_removes(size_t max_elements) {
+        auto& elements = _local._elements;
+        if (elements.bucket_count() != _bucket_count or bucket_layout(elements) != _layout) {
+            _bucket = 0;
+            _bucket_count = elements.bucket_count();
+            _layout = bucket_layout(elements);
+        }//if
+
+        size_t scanned = 0;
+        std::vector<ValueType> removed;
+        for (; _bucket < _bucket_count and scanned < max_elements; ++_bucket) {
+            // An empty bucket counts as an element, so a step is bounded in a sparse table, e.g., a reserved one
+            auto local_elem = elements.cbegin(_bucket);
+            if (local_elem == elements.cend(_bucket))
+                ++scanned;
+            for (; local_elem != elements.cend(_bucket); ++local_elem) {
+                CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+                if (ORSet<ValueType, Replicas, Containers>::_absent_remotely(local_elem->first, _remote) and
+                    ORSet<ValueType, Replicas, Containers>::_removed_remotely(local_elem->second, _remote)) {
+                    removed.push_back(local_elem->first);
+                }//if
+                ++scanned;
+            }//for
+        }//for
+
+        for (const auto& e: removed) {
+            elements.erase(e);
+            CRDTS_COUNT(ELEMENTS_ERASED, 1);
+            _removed(e);
+        }//for
+
+        if (_bucket == _bucket_count) {
+            _phase = ADDS;
+            _remote_elem = _remote._elements.cbegin();
+        }//if
+
+        return scanned;
+    }
+
+    /// Applies remote adds of at most a given number of remote elements
+    /// \return the number of scanned elements
+    size_t _step_adds(size_t max_elements) {
+        size_t scanned = 0;
+        for (; _remote_elem != _remote._elements.cend() and scanned < max_elements; ++_remote_elem, ++scanned) {
+            _local._apply_remote_add(_remote_elem->first, _remote_elem->second);
+            _added(_remote_elem->first);
+        }//for
+
+        if (_remote_elem == _remote._elements.cend())
+            _phase = VERSIONS;
+
+        return scanned;
+    }
+
+public:
+    /// Starts merging a given remote set with a given local set
+    /// \param local the local set, which must outlive the merge
+    /// \param remote the remote set, which must outlive the merge and must not change until the merge is done
+    ORSetMerge(ORSet<ValueType, Replicas, Containers>& local, const ORSet<ValueType, Replicas, Containers>& remote) :
+            _local(local), _remote(remote) {
+        _local._reserve(_local.size() + _remote.size());
+    }
+
+    /// Starts merging a given remote set that is no longer needed with a given local set, without copying it
+    /// \param local the local set, which must outlive the merge
+    /// \param remote the remote set
+    ORSetMerge(ORSet<ValueType, Replicas, Containers>& local, ORSet<ValueType, Replicas, Containers>&& remote) :
+            _local(local), _owned(new ORSet<ValueType, Replicas, Containers>(std::move(remote))), _remote(*_owned) {
+        _local._reserve(_local.size() + _remote.size());
+    }
+
+    bool step(size_t max_elements) override {
+        size_t scanned = 0;
+        while (_phase != DONE and scanned < max_elements) {
+            switch (_phase) {
+                case REMOVES:
+                    scanned += _step_removes(max_elements - scanned);
+                    break;
+                case ADDS:
+                    scanned += _step_adds(max_elements - scanned);
+                    break;
+                case VERSIONS:
+                    _local._merge_versions(_remote);
+                    _phase = DONE;
+                    break;
+                case DONE:
+                    break;
+            }//switch
+        }//while
+
+        return _phase == DONE;
+    }
+
+    /// Checks if the merge is done
+    /// \return true if the merge is done, otherwise false
+    bool done() const {
+        return _phase == DONE;
+    }
+};
+
+/// MapMerge incrementally merges a remote map with a local map. A register is merged in the same step
+/// as its key, so a key and its value are always consistent between steps.
+template<typename KeyType, typename ValueType, size_t Replicas = 0, typename Containers = StdContainers,
+         typename Stamp = Timestamp>
+class MapMerge : public ORSetMerge<KeyType, Replicas, Containers> {
+private:
+    using Registers = typename Map<KeyType, ValueType, Replicas, Containers, Stamp>::Registers;
+
+    Map<KeyType, ValueType, Replicas, Containers, Stamp>& _local_map;
+    std::unique_ptr<Registers> _owned_registers; // The remote registers if the remote map was moved in
+    const Registers& _remote_registers;
+
+    void _removed(const KeyType& key) override {
+        _local_map._erase_register(key);
+    }
+
+    void _added(const KeyType& key) override {
+        if (_owned_registers) {
+            // Remote registers are owned by the merge, so they are moved to the local map
+            auto remote_reg = _owned_registers->find(key);
+            if (remote_reg != _owned_registers->end())
+                _local_map._merge_register(*_owned_registers, remote_reg);
+        }//if
+        else {
+            auto remote_reg = _remote_registers.find(key);
+            if (remote_reg != _remote_registers.end())
+                _local_map._merge_register(remote_reg->first, remote_reg->second);
+        }//else
+    }
+
+public:
+    /// Starts merging a given remote map with a given local map
+    /// \param local the local map, which must outlive the merge
+    /// \param remote the remote map, which must outlive the merge and must not change until the merge is done
+    MapMerge(Map<KeyType, ValueType, Replicas, Containers, Stamp>& local,
+             const Map<KeyType, ValueType, Replicas, Containers, Stamp>& remote) :
+            ORSetMerge<KeyType, Replicas, Containers>(local._keys, remote._keys), _local_map(local),
+            _remote_registers(remote._registers) {
+        local._check_clock();
+        local._registers.reserve(local._registers.size() + _remote_registers.size());
+    }
+
+    /// Starts merging a given remote map that is no longer needed with a given local map, without copying it
+    /// \param local the local map, which must outlive the merge
+    /// \param remote the remote map
+    MapMerge(Map<KeyType, ValueType, Replicas, Containers, Stamp>& local,
+             Map<KeyType, ValueType, Replicas, Containers, Stamp>&& remote) :
+            ORSetMerge<KeyType, Replicas, Containers>(local._keys, std::move(remote._keys)), _local_map(local),
+            _owned_registers(new Registers(std::move(remote._registers))), _remote_registers(*_owned_registers) {
+        local._check_clock();
+        local._registers.reserve(local._registers.size() + _remote_registers.size());
+    }
+};
+
+#endif //CRDTS_INCREMENTAL_MERGE_HH
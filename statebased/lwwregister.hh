@@ -1,16 +1,34 @@
 #ifndef CRDTS_LWWREGISTER_HH
 #define CRDTS_LWWREGISTER_HH
 
+#include <utility>
+#include "../core/instrumentation.hh"
+#include "../core/memory_usage.hh"
+#include "../core/serializer.hh"
+#include "../core/hlc.hh"
 #include "../core/timestamp.hh"
 
+template<typename KeyType, typename ValueType> class DurableMap;
+template<typename KeyType, typename ValueType> class TieredMap;
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp> class Map;
+template<typename KeyType, typename ValueType, size_t Replicas, typename Stamp> class MapRegistry;
+
 /// A LWWRegister is a variant of a register, i.e., a memory cell that stores a value.
 /// LWWRegister implements the ``last write wins'' policy, where among concurrent write
 /// operation across replicas, the latest one -- based on a global ordering -- wins the
-/// race. A LWWRegister contains a Timestamp object that globally order operations.
-template<typename ValueType>
+/// race. A LWWRegister contains a Timestamp object that globally order operations. Stamp selects the type of
+/// that object: Timestamp, whose sequence numbers count the writes to the register, or HLCTimestamp, whose
+/// hybrid logical clock orders writes by physical time, so the write of a replica that lags behind in writes
+/// to the register still wins over older writes.
+template<typename ValueType, typename Stamp = Timestamp>
 class LWWRegister {
+    template<typename, typename> friend class DurableMap;
+    template<typename, typename> friend class TieredMap;
+    template<typename, typename, size_t, typename, typename> friend class Map;
+    template<typename, typename, size_t, typename> friend class MapRegistry;
+
 private:
-    Timestamp _timestamp;
+    Stamp _timestamp;
     ValueType _value;
 
 public:
@@ -25,26 +43,47 @@ public:
 
     /// Queries the value of the register
     /// \return the latest value
-    ValueType value() const {
+    const ValueType& value() const {
         return _value;
     }
 
     /// Assigns a given value to the register
     /// \param value the given value
     void assign(const ValueType& value) {
+        CRDTS_COUNT(OPERATIONS, 1);
         this->_timestamp.update();
         this->_value = value;
     }
-    void assign(const ValueType&& value) {
-        this->assign(value);
+    void assign(ValueType&& value) {
+        CRDTS_COUNT(OPERATIONS, 1);
+        this->_timestamp.update();
+        this->_value = std::move(value);
+    }
+
+    /// Assigns a value constructed from given arguments to the register
+    /// \param args the arguments of the constructor of the value
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        this->assign(ValueType(std::forward<Args>(args)...));
     }
 
     /// Merges a given register with the local register
     /// \param reg the given register
-    void merge(const LWWRegister<ValueType>& reg) {
+    void merge(const LWWRegister<ValueType, Stamp>& reg) {
         if (this->_timestamp < reg._timestamp) {
             this->_value = reg._value;
             this->_timestamp.copy(reg._timestamp);
+            CRDTS_COUNT(STAMPS_UPDATED, 1);
+        }//if
+    }
+
+    /// Merges a given register that is no longer needed with the local register, moving its value
+    /// \param reg the given register
+    void merge(LWWRegister<ValueType, Stamp>&& reg) {
+        if (this->_timestamp < reg._timestamp) {
+            this->_value = std::move(reg._value);
+            this->_timestamp.copy(reg._timestamp);
+            CRDTS_COUNT(STAMPS_UPDATED, 1);
         }//if
     }
 
@@ -53,6 +92,29 @@ public:
     uint64_t replica_id() const {
         return this->_timestamp.replica_id();
     }
+
+    /// Gets the memory footprint of the register: its value and its timestamp as metadata
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.values = footprint(_value);
+        usage.metadata = sizeof(Stamp);
+        return usage;
+    }
+
+    /// Writes the timestamp and value of the register to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        _timestamp.serialize(out);
+        Serializer<ValueType>::write(out, _value);
+    }
+
+    /// Replaces the timestamp and value of the register with those written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the register was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        return _timestamp.deserialize(in) and Serializer<ValueType>::read(in, _value);
+    }
 };
 
 #endif //CRDTS_LWWREGISTER_HH
@@ -1,115 +1,673 @@
 #ifndef CRDTS_MAP_HH
 #define CRDTS_MAP_HH
 
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include "gcounter.hh"
 #include "orset.hh"
 #include "lwwregister.hh"
+#include "sequence.hh"
+
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp> class MapMerge;
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp> class Map;
+
+/// Checks if a value type of Map is a CRDT, which Map stores and merges in place instead of keeping it in a
+/// LWWRegister
+template<typename ValueType>
+struct IsNestedCRDT : std::false_type { };
+
+template<typename ValueType, size_t Replicas, typename Containers>
+struct IsNestedCRDT<ORSet<ValueType, Replicas, Containers>> : std::true_type { };
+
+template<typename ValueType, typename Containers>
+struct IsNestedCRDT<GCounter<ValueType, Containers>> : std::true_type { };
+
+template<typename ValueType>
+struct IsNestedCRDT<Sequence<ValueType>> : std::true_type { };
+
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp>
+struct IsNestedCRDT<Map<KeyType, ValueType, Replicas, Containers, Stamp>> : std::true_type { };
+
+/// Checks if the keys of a Map with a given value type can be removed. A GCounter cannot forget its counts, so a
+/// counter created again for a removed key would continue from the counts that other replicas still hold for the
+/// removed counter; keys whose values hold counters, directly or in nested maps, cannot be removed.
+template<typename ValueType>
+struct IsRemovableValue : std::true_type { };
+
+template<typename ValueType, typename Containers>
+struct IsRemovableValue<GCounter<ValueType, Containers>> : std::false_type { };
+
+template<typename KeyType, typename ValueType, size_t Replicas, typename Containers, typename Stamp>
+struct IsRemovableValue<Map<KeyType, ValueType, Replicas, Containers, Stamp>> : IsRemovableValue<ValueType> { };
 
 /// Map is a convergent map with the ``add wins'' policy for keys and the ``last writer wins'' policy for values.
 /// Map maintains keys in an ORSet to implement the former policy. By keeping each value in a LWWRegister, Map
-/// implements the latter policy.
-template<typename KeyType, typename ValueType>
+/// implements the latter policy. Replicas is the number of replicas if it is known at compile time, Containers
+/// selects the hash tables of keys and registers (see ORSet), and Stamp the timestamps of registers (see
+/// LWWRegister).
+///
+/// If the value type is itself a CRDT (ORSet, GCounter, Sequence, or Map, see IsNestedCRDT), Map stores the value
+/// of each key in place of its register and merges it with the value of the key at other replicas, so concurrent
+/// updates of a value are not lost. Such values are changed in place by update, and delta gets the change of a
+/// key, or of a single field of a nested value, to ship instead of the whole map. Removing a key drops its value,
+/// and the map only keeps the greatest sequence number that the replica issued in removed values. A value created
+/// again for the key continues from it, so it does not reissue the dots of the removed value, and the elements the
+/// replica added to the removed value do not come back from replicas that still hold it. Keys of counters cannot
+/// be removed (see IsRemovableValue).
+template<typename KeyType, typename ValueType, size_t Replicas = 0, typename Containers = StdContainers,
+         typename Stamp = Timestamp>
 class Map {
+    friend class DurableMap<KeyType, ValueType>;
+    friend class TieredMap<KeyType, ValueType>;
+    friend class MapMerge<KeyType, ValueType, Replicas, Containers, Stamp>;
+
+public:
+    // The type of keys accepted by lookups, e.g., std::string_view for std::string keys in flat tables
+    using Lookup = typename Containers::template Lookup<KeyType>;
+    using Context = typename ORSet<KeyType, Replicas, Containers>::Context;
+
 private:
-    ORSet<KeyType> _keys;
-    std::unordered_map<KeyType, LWWRegister<ValueType>> _registers;
+    // The register of a key, or its value if the value type is a CRDT
+    using Register = typename std::conditional<IsNestedCRDT<ValueType>::value, ValueType,
+                                               LWWRegister<ValueType, Stamp>>::type;
+    using Registers = typename Containers::template Map<KeyType, Register>;
+
+    ORSet<KeyType, Replicas, Containers> _keys;
+    Registers _registers;
+    // The greatest sequence number of the register timestamps issued by the replica (see _assign), or of the
+    // dots it issued in the values of removed keys if the value type is a CRDT (see _erase_register)
+    uint64_t _clock{};
+
+    /// Merges the register associated to a given key with a given remote register
+    /// \param key the given key
+    /// \param remote_reg the given remote register
+    void _merge_register(const KeyType& key, const Register& remote_reg) {
+        CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+        CRDTS_COUNT(HASH_PROBES, 1);
+        auto local_reg = this->_registers.find(key);
+        if (local_reg != this->_registers.end()) {
+            // The associated register locally exists, merge it with the remote register
+            local_reg->second.merge(remote_reg);
+        }//if
+        else if (this->_keys.contains(key)) {
+            // The register associate to the remote key does not locally exist, add the associated register.
+            // Merging a new register with the remote register copies the remote value and timestamp, so the
+            // replica does not issue a timestamp for a value it has not assigned.
+            this->_register(KeyType(key)).merge(remote_reg);
+            CRDTS_COUNT(ELEMENTS_ADDED, 1);
+        }//else if
+    }
+
+    /// Merges the register associated to a given key with a given remote register that is no longer needed.
+    /// A new register takes the node of the remote register, so neither the key nor the value is copied.
+    /// \param remote_registers the remote registers
+    /// \param remote_reg the remote register
+    void _merge_register(Registers& remote_registers, typename Registers::iterator remote_reg) {
+        CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+        CRDTS_COUNT(HASH_PROBES, 1);
+        auto local_reg = this->_registers.find(remote_reg->first);
+        if (local_reg != this->_registers.end()) {
+            local_reg->second.merge(std::move(remote_reg->second));
+        }//if
+        else if (this->_keys.contains(remote_reg->first)) {
+            auto node = remote_registers.extract(remote_reg);
+            auto reg = _new_register();
+            _advance(reg);
+            reg.merge(std::move(node.mapped()));
+            node.mapped() = std::move(reg);
+            this->_registers.insert(std::move(node));
+            CRDTS_COUNT(ELEMENTS_ADDED, 1);
+        }//else if
+    }
+
+    /// Creates an empty register, or an empty value if the value type is a CRDT, at the local replica
+    /// \return the register
+    Register _new_register() const {
+        if constexpr (std::is_constructible<Register, uint64_t>::value) {
+            return Register(replica_id());
+        }//if
+        else {
+            Register reg;
+            reg.replica_id(replica_id());
+            return reg;
+        }//else
+    }
+
+    /// Gets the register associated to a given key, and creates it if it does not exist
+    /// \param key the given key
+    /// \return the register
+    Register& _register(KeyType&& key) {
+        if constexpr (std::is_default_constructible<Register>::value) {
+            auto reg = _registers.try_emplace(std::move(key));
+            if (reg.second) {
+                // initialize a register for the first time
+                reg.first->second.replica_id(_keys.replica_id());
+                _advance(reg.first->second);
+            }//if
+
+            return reg.first->second;
+        }//if
+        else {
+            auto reg = _registers.find(key);
+            if (reg == _registers.end()) {
+                reg = _registers.emplace(std::move(key), _new_register()).first;
+                _advance(reg->second);
+            }//if
+
+            return reg->second;
+        }//else
+    }
+
+    // Checks if a type provides the clock of the dots that the replica issued in it
+    template<typename T, typename = void>
+    struct HasClock : std::false_type { };
+
+    template<typename T>
+    struct HasClock<T, std::void_t<decltype(std::declval<const T&>().clock())>> : std::true_type { };
+
+    /// Advances the clock of a value created for a key past the dots that the replica issued in the values of
+    /// removed keys, so the value does not reissue the dots of a removed value of the key
+    /// \param reg the register holding the value
+    void _advance(Register& reg) const {
+        if constexpr (IsNestedCRDT<ValueType>::value and HasClock<Register>::value) {
+            if (_clock > 0)
+                reg.advance(_clock);
+        }//if
+    }
+
+    /// Assigns a given value to a given register with a timestamp that the replica has not issued before. A
+    /// register created again for a removed key starts from an empty timestamp, so incrementing its sequence
+    /// number alone would reissue a timestamp of the removed register, which other replicas may still hold with
+    /// another value. Timestamps of a hybrid logical clock are never reissued.
+    /// \param reg the given register
+    /// \param val the given value
+    template<typename Value>
+    void _assign(Register& reg, Value&& val) {
+        if constexpr (std::is_same<Stamp, Timestamp>::value) {
+            reg._timestamp.advance(_clock);
+            reg.assign(std::forward<Value>(val));
+            _clock = reg._timestamp.sequence_number();
+        }//if
+        else {
+            reg.assign(std::forward<Value>(val));
+        }//else
+    }
+
+    /// Checks that the clock that stamps the registers of the map belongs to the local replica, before a put or a
+    /// merge changes the map. A HLCTimestamp does not store the replica id of its register, as in MapRegistry, and
+    /// a put or merge that threw with the map half changed would leave a key without its value.
+    /// \throw std::logic_error if no hybrid logical clock is installed, or it belongs to another replica
+    void _check_clock() const {
+        if constexpr (std::is_same<Stamp, HLCTimestamp>::value) {
+            if (hybrid_clock().replica_id() != replica_id())
+                throw std::logic_error("the hybrid logical clock of the thread belongs to another replica");
+        }//if
+    }
+
+    /// Gets the value held by a register
+    /// \param reg the register
+    /// \return the value
+    static const ValueType& _value(const Register& reg) {
+        if constexpr (IsNestedCRDT<ValueType>::value)
+            return reg;
+        else
+            return reg.value();
+    }
+
+    // Checks if a type provides a delta without arguments
+    template<typename T, typename = void>
+    struct HasDelta : std::false_type { };
+
+    template<typename T>
+    struct HasDelta<T, std::void_t<decltype(std::declval<const T&>().delta())>> : std::true_type { };
+
+    /// Gets the delta of a register: the delta of a given field of a nested value if a path is given, the delta
+    /// of the value if its type provides one, e.g., the local count of a GCounter, and the register otherwise
+    /// \param reg the register
+    /// \param path the keys or elements that select the field
+    /// \return the delta
+    template<typename... Path>
+    static Register _register_delta(const Register& reg, const Path&... path) {
+        if constexpr (sizeof...(Path) > 0)
+            return reg.delta(path...);
+        else if constexpr (HasDelta<Register>::value)
+            return reg.delta();
+        else
+            return reg;
+    }
+
+    /// Erases the register of a removed key. If the value type is a CRDT, the clock of the map keeps the dots that
+    /// the replica issued in the value, so a value created again for the key continues from them (see _advance).
+    /// \param reg the register
+    /// \return the iterator to the next register
+    typename Registers::iterator _erase_register(typename Registers::iterator reg) {
+        if constexpr (IsNestedCRDT<ValueType>::value and HasClock<Register>::value)
+            _clock = std::max(_clock, reg->second.clock());
+
+        return this->_registers.erase(reg);
+    }
+
+    /// Erases the register of a removed key, see _erase_register
+    /// \param key the key
+    void _erase_register(const KeyType& key) {
+        auto reg = this->_registers.find(key);
+        if (reg != this->_registers.end())
+            _erase_register(reg);
+    }
+
+    /// Removes registers whose keys have been removed in merging keys
+    void _remove_registers() {
+        for (auto reg = this->_registers.begin(); reg != this->_registers.end(); /* no increment here */) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            CRDTS_COUNT(HASH_PROBES, 1);
+            if (this->_keys.contains(reg->first)) {
+                ++reg;
+            }//if
+            else {
+                reg = _erase_register(reg);
+                CRDTS_COUNT(ELEMENTS_ERASED, 1);
+            }//else
+        }//for
+    }
 
 public:
     /// Creates a map object with a given replica id
     /// \param replica_id the given replica id
     explicit Map(uint64_t replica_id) : _keys(replica_id) { }
 
-    /// Puts a given key and value pair to the map
+    /// Puts a given key and value pair to the map. If the value type is a CRDT, the given value is merged with
+    /// the value of the key.
     /// \param key the given key
     /// \param val the given value
-    void put(const KeyType& key, const ValueType& val)  {
+    /// \throw std::logic_error with HLCTimestamp stamps if the installed clock is missing or belongs to another
+    /// replica; the map is not changed
+    void put(KeyType key, ValueType val)  {
+        _check_clock();
         _keys.add(key);
-        if (_registers.count(key) == 0) {
-            // initialize a register for the first time
-            _registers[key].replica_id(_keys.replica_id());
-        }//if
+        if constexpr (IsNestedCRDT<ValueType>::value)
+            _register(std::move(key)).merge(std::move(val));
+        else
+            _assign(_register(std::move(key)), std::move(val));
+    }
+
+    /// Changes the value of a given key in place, adding the key if it does not exist. The value type must be
+    /// a CRDT. Updating a key adds it again, so a concurrent remove of the key does not discard the update.
+    /// \param key the given key
+    /// \param f the function that changes the value, taking it by reference
+    template<typename Function>
+    void update(KeyType key, Function&& f) {
+        static_assert(IsNestedCRDT<ValueType>::value, "update requires a CRDT value type");
+        _keys.add(key);
+        f(_register(std::move(key)));
+    }
+
+    /// Gets a delta of the map for a given key, i.e., a map holding only the key with the dots of its adds (see
+    /// ORSet::delta) and the delta of its value. If a path of keys or elements is given, the value of the delta
+    /// is the delta of the selected field of the nested value, e.g., delta("user", "clicks") of a map of maps of
+    /// counters holds the local count of the counter "clicks" only. Merging the delta at another replica applies
+    /// the change of the key without shipping the rest of the map; removes are not covered by deltas.
+    /// \param key the given key
+    /// \param path the keys or elements that select a field of the nested value
+    /// \return the delta
+    template<typename... Path>
+    Map<KeyType, ValueType, Replicas, Containers, Stamp> delta(const KeyType& key, const Path&... path) const {
+        Map<KeyType, ValueType, Replicas, Containers, Stamp> result(replica_id());
+        result._keys = _keys.delta(key);
+        auto reg = _registers.find(key);
+        if (reg != _registers.end())
+            result._registers.emplace(key, _register_delta(reg->second, path...));
+
+        return result;
+    }
+
+    /// Puts a given key and a value constructed from given arguments to the map
+    /// \param key the given key
+    /// \param args the arguments of the constructor of the value
+    /// \throw std::logic_error with HLCTimestamp stamps, see put
+    template<typename... Args>
+    void emplace(KeyType key, Args&&... args) {
+        _check_clock();
+        _keys.add(key);
+        if constexpr (IsNestedCRDT<ValueType>::value)
+            _register(std::move(key)).emplace(std::forward<Args>(args)...);
+        else
+            _assign(_register(std::move(key)), ValueType(std::forward<Args>(args)...));
+    }
+
+    /// Puts a given key and a value constructed from given arguments to the map if the key does not exist;
+    /// the value is not constructed otherwise
+    /// \param key the given key
+    /// \param args the arguments of the constructor of the value
+    /// \return true if the key and value were put, otherwise false
+    template<typename... Args>
+    bool try_emplace(KeyType key, Args&&... args) {
+        if (this->contains(key))
+            return false;
 
-        _registers[key].assign(val);
+        emplace(std::move(key), std::forward<Args>(args)...);
+        return true;
     }
 
     /// Gets the value of a given key
     /// \param key the given key
     /// \return the value
-    ValueType get(const KeyType& key) {
+    ValueType get(Lookup key) const {
         if (!this->contains(key)) {
             throw std::exception();
         }//if
 
-        return _registers[key].value();
+        auto reg = _registers.find(key);
+        if (reg != _registers.end())
+            return _value(reg->second);
+        if constexpr (IsNestedCRDT<ValueType>::value)
+            return _new_register();
+        else
+            return ValueType();
     }
 
-    /// Removes a given key from the map
+    /// Gets the values of several keys without copying them. Flat tables prefetch the slots of a batch of keys
+    /// before probing them (see ORSet::contains_many).
+    /// \param keys the keys, which must have the key type unless lookups take them by value
+    /// \return a vector holding a pointer to the value of each key, or nullptr if the key does not exist; the
+    /// pointers are invalidated by the next update of the map
+    template<typename Key>
+    std::vector<const ValueType*> get_many(const std::vector<Key>& keys) const {
+        static_assert(std::is_same<Key, KeyType>::value or !std::is_reference<Lookup>::value,
+                      "keys must have the key type");
+        std::vector<const ValueType*> result(keys.size());
+        find_many(_registers, keys.size(), [&keys](size_t i) -> Lookup { return keys[i]; },
+                  [this, &result](size_t i, typename Registers::const_iterator reg) {
+                      if (reg != _registers.end())
+                          result[i] = &_value(reg->second);
+                  });
+
+        return result;
+    }
+
+    /// Removes a given key from the map. The value type must not hold counters, see IsRemovableValue.
     /// \param key the given key
     void remove(const KeyType& key) {
+        static_assert(IsRemovableValue<ValueType>::value, "keys of counters cannot be removed");
         _keys.remove(key);
-        _registers.erase(key);
+        _erase_register(key);
+    }
+
+    /// Removes all keys from the map, see remove
+    void clear() {
+        std::vector<KeyType> keys;
+        for (const auto& key: _keys._elements)
+            keys.push_back(key.first);
+        for (const auto& key: keys)
+            remove(key);
     }
 
     /// Merges a given map with the local map
     /// \param map the given map
-    void merge(const Map<KeyType, ValueType>& map) {
-        ORSet<KeyType> keys_copy = this->_keys;
+    /// \throw std::logic_error with HLCTimestamp stamps, see put
+    void merge(const Map<KeyType, ValueType, Replicas, Containers, Stamp>& map) {
+        _check_clock();
 
         // Merge keys
         this->_keys.merge(map._keys);
 
         // Remove keys deleted in merging keys (above)
-        for (const auto& k: keys_copy.elements()) {
-            if (!this->_keys.contains(k)) {
-                this->_registers.erase(k);
-            }//if
-        }//for
+        CRDTS_PHASE(REGISTERS);
+        _remove_registers();
 
         // Merge registers associated with remaining keys
-        for (const auto& remote_reg: map._registers) {
-            auto local_reg = this->_registers.find(remote_reg.first);
-            if (local_reg != this->_registers.end()) {
-                // The associated register locally exists, merge it with the remote register
-                local_reg->second.merge(remote_reg.second);
-            }//if
-            else if (this->_keys.contains(remote_reg.first)) {
-                // The register associate to the remote key does not locally exist, add the associated register.
-                // We initialize the local register with the remote value, then merge two registers.
-                this->_registers[remote_reg.first].replica_id(this->replica_id());
-                this->_registers[remote_reg.first].assign(remote_reg.second.value());
-                this->_registers[remote_reg.first].merge(remote_reg.second);
-            }//else if
+        for (const auto& remote_reg: map._registers)
+            _merge_register(remote_reg.first, remote_reg.second);
+    }
+
+    /// Merges a given map that is no longer needed with the local map. Added keys and values are moved from the
+    /// given map instead of being copied; the given map is left in a valid but unspecified state.
+    /// \param map the given map
+    /// \throw std::logic_error with HLCTimestamp stamps, see put
+    void merge(Map<KeyType, ValueType, Replicas, Containers, Stamp>&& map) {
+        _check_clock();
+
+        // Merge keys
+        this->_keys.merge(std::move(map._keys));
+
+        // Remove keys deleted in merging keys (above)
+        CRDTS_PHASE(REGISTERS);
+        _remove_registers();
+
+        // Merge registers associated with remaining keys
+        auto& remote_registers = map._registers;
+        for (auto remote_reg = remote_registers.begin(); remote_reg != remote_registers.end(); /* no increment here */)
+            _merge_register(remote_registers, remote_reg++);
+    }
+
+    /// Merges the local map with several remote maps. Keys are merged in a single pass as in ORSet::merge_all,
+    /// then registers of the remaining keys are merged with the registers of all remote maps. The values are the
+    /// same as merging the remote maps one by one: a key that is removed by one of the remote maps and added
+    /// again by a later one only takes the registers of the remote maps since it was added again.
+    /// \param maps the given remote maps
+    /// \throw std::logic_error with HLCTimestamp stamps, see put
+    void merge_all(const std::vector<const Map<KeyType, ValueType, Replicas, Containers, Stamp>*>& maps) {
+        _check_clock();
+        std::vector<const ORSet<KeyType, Replicas, Containers>*> keys;
+        for (auto map: maps)
+            keys.push_back(&map->_keys);
+
+        // Merge keys
+        typename Containers::template Map<KeyType, size_t> restarts;
+        this->_keys._merge_all(keys, &restarts);
+
+        // Remove keys deleted in merging keys (above), and registers of keys that were removed and added again
+        CRDTS_PHASE(REGISTERS);
+        _remove_registers();
+        for (const auto& restart: restarts)
+            _erase_register(restart.first);
+
+        // Merge registers associated with remaining keys
+        for (size_t i = 0; i < maps.size(); ++i) {
+            for (const auto& remote_reg: maps[i]->_registers) {
+                if (!restarts.empty()) {
+                    auto restart = restarts.find(remote_reg.first);
+                    if (restart != restarts.end() and restart->second > i)
+                        continue;
+                }//if
+                _merge_register(remote_reg.first, remote_reg.second);
+            }//for
+        }//for
+    }
+
+    /// Merges the local map with a range of remote maps, see merge_all
+    /// \param first the iterator to the first remote map
+    /// \param last the iterator past the last remote map
+    template<typename Iterator>
+    void merge_all(Iterator first, Iterator last) {
+        std::vector<const Map<KeyType, ValueType, Replicas, Containers, Stamp>*> maps;
+        for (; first != last; ++first)
+            maps.push_back(&*first);
+
+        merge_all(maps);
+    }
+
+    /// Enables the summary of the keys, see ORSet::enable_summary
+    /// \param bits_per_key the number of bits per key, which sets the rate of false positives
+    void enable_summary(uint32_t bits_per_key = 10) {
+        _keys.enable_summary(bits_per_key);
+    }
+
+    /// Gets the summary of the keys for a sync, see ORSet::summary
+    /// \return the summary, which is empty if the summary is not enabled
+    const BloomFilter& summary() {
+        return _keys.summary();
+    }
+
+    /// Gets the causal context of the keys, which a replica sends to get the state it has not observed
+    /// \return the causal context
+    const Context& context() const {
+        return _keys.context();
+    }
+
+    /// Gets the part of the state that a remote replica with a given causal context has not observed: the keys
+    /// of ORSet::sync_state with their registers. A put or update of a key adds the key again, so every value the
+    /// remote replica has not observed belongs to one of these keys.
+    /// \param remote_context the causal context of the remote replica
+    /// \return the state
+    Map<KeyType, ValueType, Replicas, Containers, Stamp> sync_state(const Context& remote_context) const {
+        Map<KeyType, ValueType, Replicas, Containers, Stamp> result(replica_id());
+        result._keys = _keys.sync_state(remote_context);
+        for (const auto& key: result._keys._elements) {
+            CRDTS_COUNT(HASH_PROBES, 1);
+            auto reg = _registers.find(key.first);
+            if (reg != _registers.end())
+                result._registers.emplace(reg->first, reg->second);
         }//for
+
+        return result;
+    }
+
+    /// Merges the local map with the state of a remote map returned by sync_state for the local causal context,
+    /// given the summary of the remote map taken with that state (see ORSet::merge_sync)
+    /// \param remote_state the state of the remote map
+    /// \param remote_summary the summary of the remote map
+    /// \throw std::logic_error with HLCTimestamp stamps, see put
+    void merge_sync(const Map<KeyType, ValueType, Replicas, Containers, Stamp>& remote_state,
+                    const BloomFilter& remote_summary) {
+        _check_clock();
+
+        // Merge keys
+        this->_keys.merge_sync(remote_state._keys, remote_summary);
+
+        // Remove keys deleted in merging keys (above)
+        CRDTS_PHASE(REGISTERS);
+        _remove_registers();
+
+        // Merge registers associated with remaining keys
+        for (const auto& remote_reg: remote_state._registers)
+            _merge_register(remote_reg.first, remote_reg.second);
     }
 
     /// Checks the existence of a given key
     /// \param key the given key
     /// \return true if the key exists, otherwise false
-    bool contains(const KeyType& key) {
+    bool contains(Lookup key) const {
         return _keys.contains(key);
     }
 
+    /// Checks the existence of several keys, see ORSet::contains_many
+    /// \param keys the keys
+    /// \return a vector holding true for each key that exists, otherwise false
+    template<typename Key>
+    std::vector<bool> contains_many(const std::vector<Key>& keys) const {
+        return _keys.contains_many(keys);
+    }
+
     /// Gets the number of key value pairs in the map
     /// \return the number of key value pairs
-    size_t size() {
+    size_t size() const {
         return _keys.size();
     }
 
     /// Gets the replica id
     /// \return the replica id
-    uint64_t replica_id() {
+    uint64_t replica_id() const {
         return _keys.replica_id();
     }
 
+    /// Gets the greatest sequence number that the replica has issued in the map, i.e., in the dots of its keys,
+    /// the timestamps of its registers, and its nested values, so a map that replaces it as the value of a removed
+    /// key of a Map continues from it (see advance)
+    /// \return the sequence number
+    uint64_t clock() const {
+        auto result = std::max(_clock, _keys.clock());
+        if constexpr (IsNestedCRDT<ValueType>::value and HasClock<Register>::value) {
+            for (const auto& reg: _registers)
+                result = std::max(result, reg.second.clock());
+        }//if
+
+        return result;
+    }
+
+    /// Ensures that the dots of later adds of keys, the timestamps of later puts, and the dots of nested values
+    /// created from now on are greater than a given sequence number, see ORSet::advance
+    /// \param seq_number the given sequence number
+    void advance(uint64_t seq_number) {
+        _keys.advance(seq_number);
+        _clock = std::max(_clock, seq_number);
+    }
+
     /// Gets the key value pairs stored in the map
     /// \return all key value pairs
     std::unordered_map<KeyType, ValueType> key_value_pairs() {
         std::unordered_map<KeyType, ValueType> res;
         for (const auto& kv: _registers)
-            res[kv.first] = kv.second.value();
+            res.emplace(kv.first, _value(kv.second));
 
         return res;
     }
+
+    /// Shares the buffers of equal values, e.g., after merging or reading values from other replicas.
+    /// The value type must be SharedValue<T>, and timestamps are not changed.
+    /// \param pool the pool that deduplicates values
+    template<typename Pool>
+    void intern_values(Pool& pool) {
+        for (auto& reg: _registers)
+            reg.second._value = pool.intern(reg.second._value);
+    }
+
+    /// Gets the memory footprint of the map, including its key set. The copy of each key in the table of registers
+    /// is counted as overhead, since it duplicates a key of the key set.
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        auto usage = _keys.memory_usage();
+        usage.overhead += hash_table_overhead(_registers);
+        for (const auto& reg: _registers) {
+            usage.overhead += footprint(reg.first);
+            usage += reg.second.memory_usage();
+        }//for
+
+        return usage;
+    }
+
+    /// Writes the state of the map, i.e., its keys, its clock, and registers, to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        _keys.serialize(out);
+        Serializer<uint64_t>::write(out, _clock);
+
+        Serializer<uint64_t>::write(out, _registers.size());
+        for (const auto& reg: _registers) {
+            Serializer<KeyType>::write(out, reg.first);
+            reg.second.serialize(out);
+        }//for
+    }
+
+    /// Replaces the state of the map with a state written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the state was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        ORSet<KeyType, Replicas, Containers> keys(0);
+        uint64_t clock, registers;
+        if (!keys.deserialize(in) or !Serializer<uint64_t>::read(in, clock) or
+            !Serializer<uint64_t>::read(in, registers))
+            return false;
+
+        Registers registers_read;
+        for (uint64_t i = 0; i < registers; ++i) {
+            KeyType k;
+            if (!Serializer<KeyType>::read(in, k))
+                return false;
+
+            auto reg = registers_read.emplace(std::move(k), _new_register()).first;
+            if (!reg->second.deserialize(in))
+                return false;
+        }//for
+
+        this->_keys = keys;
+        this->_clock = clock;
+        this->_registers.swap(registers_read);
+        return true;
+    }
 };
 
 #endif //CRDTS_MAP_HH
@@ -0,0 +1,430 @@
+#ifndef CRDTS_MAP_REGISTRY_HH
+#define CRDTS_MAP_REGISTRY_HH
+
+#include <cstdint>
+#include <exception>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include "../core/hlc.hh"
+#include "../core/instrumentation.hh"
+#include "../core/memory_usage.hh"
+#include "../core/replicas.hh"
+#include "../core/serializer.hh"
+#include "lwwregister.hh"
+
+/// MapRegistry hosts the maps of many tenants at a replica, each of which behaves as a Map with the ``add wins''
+/// policy for keys and the ``last writer wins'' policy for values. A Map carries its own replica id, causal
+/// context, and hash tables of keys and registers, which outweigh the data of a map with a few keys. Instead, the
+/// registry stores the entries of all tenants in a single tree ordered by tenant and key, and the replicas of all
+/// tenants share one replica id and one causal context: a dot identifies an add at a replica, whichever tenant it
+/// belongs to. A tenant without keys costs nothing, and a key costs its entry: its tags, its register, and a node
+/// of the tree. With a fixed number of replicas (see ReplicaTraits) and HLCTimestamp stamps, the metadata of an
+/// entry is a few tens of bytes.
+///
+/// The entries of a tenant are contiguous in the tree, so a tenant is listed or removed without a per-tenant
+/// index. Registries are merged as a whole: merge walks the entries of both registries in order, so the changes
+/// of many tenants received in one replication stream are merged in a single pass without hashing, and the causal
+/// contexts are joined once.
+template<typename KeyType, typename ValueType, size_t Replicas = 0, typename Stamp = Timestamp>
+class MapRegistry {
+public:
+    using Context = typename ReplicaTraits<Replicas>::Context;
+
+private:
+    using Tags = typename ReplicaTraits<Replicas>::Tags;
+
+    struct Entry {
+        Tags tags;                              // The tags of the key, see ORSet
+        LWWRegister<ValueType, Stamp> reg;
+    };
+
+    /// Orders entries by tenant, then by key. Lookups take a pair of a tenant and a reference to a key, so a key
+    /// is not copied, or a tenant alone to find the range of its entries.
+    struct EntryOrder {
+        using is_transparent = void;
+
+        template<typename Entry1, typename Entry2>
+        bool operator () (const Entry1& e1, const Entry2& e2) const {
+            return e1.first < e2.first or (e1.first == e2.first and e1.second < e2.second);
+        }
+
+        template<typename Entry1>
+        bool operator () (const Entry1& e, uint64_t tenant) const {
+            return e.first < tenant;
+        }
+
+        template<typename Entry2>
+        bool operator () (uint64_t tenant, const Entry2& e) const {
+            return tenant < e.first;
+        }
+    };
+
+    using Entries = std::map<std::pair<uint64_t, KeyType>, Entry, EntryOrder>;
+    using Lookup = std::pair<uint64_t, const KeyType&>;
+
+    Entries _entries;
+    Context _context; // The add operations observed by the local replica, in all tenants
+    uint64_t _replica_id;
+    uint64_t _clock{}; // The greatest sequence number of the register timestamps issued by the replica
+
+    /// Checks if a tag has not been observed in a given causal context
+    /// \param context the given causal context
+    /// \param tag the sequence number associated to a replica id
+    /// \return true if the tag is not in the context, otherwise false
+    template<typename Tag>
+    static bool _unobserved(const Context& context, const Tag& tag) {
+        return !context.contains(tag.first, tag.second);
+    }
+
+    /// Checks if a local entry that does not exist in a remote registry has been removed remotely, as
+    /// ORSet does for elements
+    /// \param local_tags the tags of the local entry
+    /// \param remote_context the causal context of the remote registry
+    /// \return true if the entry has been removed remotely, otherwise false
+    static bool _removed_remotely(const Tags& local_tags, const Context& remote_context) {
+        // A concurrent or newer local add wins over the remote remove
+        for (const auto& local_add: local_tags) {
+            if (!remote_context.contains(local_add.first, local_add.second))
+                return false;
+        }//for
+
+        // Find an evidence of a remote remove in the versions of replicas observed remotely
+        for (const auto& remote_remove: remote_context) {
+            auto local_add = local_tags.find(remote_remove.first);
+            if (local_add == local_tags.end() or local_add->second < remote_remove.second.max())
+                return true;
+        }//for
+
+        return false;
+    }
+
+    /// Checks if a remote entry that does not exist locally must be added
+    /// \param remote_tags the tags of the remote entry
+    /// \return true if the entry has been added after the local replica observed it, otherwise false
+    bool _added_remotely(const Tags& remote_tags) const {
+        for (const auto& remote_timestamp: remote_tags) {
+            if (_unobserved(_context, remote_timestamp))
+                return true;
+        }//for
+
+        return false;
+    }
+
+    /// Merges a remote entry with an entry that exists locally
+    /// \param local the local entry
+    /// \param remote the remote entry
+    void _merge_entry(Entry& local, const Entry& remote) {
+        for (const auto& remote_timestamp: remote.tags) {
+            if (_unobserved(_context, remote_timestamp)) {
+                local.tags[remote_timestamp.first] = remote_timestamp.second;
+                CRDTS_COUNT(STAMPS_UPDATED, 1);
+            }//if
+        }//for
+        local.reg.merge(remote.reg);
+    }
+
+    /// Adds the entry of a remote key that does not exist locally, see merge
+    /// \param hint the local entry after the key
+    /// \param remote_entry the remote entry
+    void _insert_entry(typename Entries::iterator hint, const typename Entries::value_type& remote_entry) {
+        // The register takes the local replica id, as the register of a key added by put does
+        auto entry = _entries.emplace_hint(hint, std::piecewise_construct, std::forward_as_tuple(remote_entry.first),
+                                           std::forward_as_tuple());
+        entry->second.tags = remote_entry.second.tags;
+        entry->second.reg.replica_id(_replica_id);
+        entry->second.reg.merge(remote_entry.second.reg);
+        CRDTS_COUNT(ELEMENTS_ADDED, 1);
+    }
+
+    /// Gets the entry of a key of a tenant, and creates it if it does not exist; the key is tagged with the next
+    /// sequence number of the local replica. A HLCTimestamp does not store the replica id of its register, so the
+    /// clock that will stamp the write is checked to be the clock of the local replica.
+    /// \param tenant the tenant
+    /// \param key the key
+    /// \return the register of the key
+    /// \throw std::logic_error if no hybrid logical clock is installed, or it belongs to another replica
+    LWWRegister<ValueType, Stamp>& _add(uint64_t tenant, KeyType&& key) {
+        if constexpr (std::is_same<Stamp, HLCTimestamp>::value) {
+            if (hybrid_clock().replica_id() != _replica_id)
+                throw std::logic_error("the hybrid logical clock of the thread belongs to another replica");
+        }//if
+
+        CRDTS_COUNT(OPERATIONS, 1);
+        auto entry = _entries.lower_bound(Lookup(tenant, key));
+        if (entry == _entries.end() or EntryOrder()(Lookup(tenant, key), entry->first)) {
+            entry = _entries.emplace_hint(entry, std::piecewise_construct,
+                                          std::forward_as_tuple(tenant, std::move(key)), std::forward_as_tuple());
+            entry->second.reg.replica_id(_replica_id);
+        }//if
+
+        auto seq_number = _context.max(_replica_id) + 1;
+        _context.add(_replica_id, seq_number);
+        entry->second.tags[_replica_id] = seq_number;
+        return entry->second.reg;
+    }
+
+public:
+    /// Creates a registry at a replica identified with a given id
+    /// \param replica_id the given replica id
+    explicit MapRegistry(uint64_t replica_id) : _replica_id(replica_id) {
+        if (!ReplicaTraits<Replicas>::valid(replica_id))
+            throw std::out_of_range("replica id " + std::to_string(replica_id) + " exceeds the number of replicas");
+
+        _context.add_replica(replica_id);
+    }
+
+    /// Puts a given key and value pair to the map of a tenant
+    /// \param tenant the tenant
+    /// \param key the given key
+    /// \param val the given value
+    void put(uint64_t tenant, KeyType key, ValueType val) {
+        auto& reg = _add(tenant, std::move(key));
+        if constexpr (std::is_same<Stamp, Timestamp>::value) {
+            // A register created again for a removed key starts from an empty timestamp, so it is advanced past
+            // every timestamp the replica has issued, as Map::_assign does
+            reg._timestamp.advance(_clock);
+            reg.assign(std::move(val));
+            _clock = reg._timestamp.sequence_number();
+        }//if
+        else {
+            reg.assign(std::move(val));
+        }//else
+    }
+
+    /// Gets the value of a given key of a tenant
+    /// \param tenant the tenant
+    /// \param key the given key
+    /// \return the value
+    const ValueType& get(uint64_t tenant, const KeyType& key) const {
+        auto entry = _entries.find(Lookup(tenant, key));
+        if (entry == _entries.end()) {
+            throw std::exception();
+        }//if
+
+        return entry->second.reg.value();
+    }
+
+    /// Checks the existence of a given key of a tenant
+    /// \param tenant the tenant
+    /// \param key the given key
+    /// \return true if the key exists, otherwise false
+    bool contains(uint64_t tenant, const KeyType& key) const {
+        return _entries.find(Lookup(tenant, key)) != _entries.end();
+    }
+
+    /// Removes a given key from the map of a tenant
+    /// \param tenant the tenant
+    /// \param key the given key
+    /// \return true if the key existed and was removed, otherwise false
+    bool remove(uint64_t tenant, const KeyType& key) {
+        auto entry = _entries.find(Lookup(tenant, key));
+        if (entry == _entries.end())
+            return false;
+
+        _entries.erase(entry);
+        return true;
+    }
+
+    /// Removes all keys of a tenant
+    /// \param tenant the tenant
+    /// \return the number of removed keys
+    size_t remove_tenant(uint64_t tenant) {
+        auto range = _entries.equal_range(tenant);
+        auto removed = std::distance(range.first, range.second);
+        _entries.erase(range.first, range.second);
+        return removed;
+    }
+
+    /// Gets the number of keys of a tenant
+    /// \param tenant the tenant
+    /// \return the number of keys
+    size_t size(uint64_t tenant) const {
+        auto range = _entries.equal_range(tenant);
+        return std::distance(range.first, range.second);
+    }
+
+    /// Gets the number of keys of all tenants
+    /// \return the number of keys
+    size_t size() const {
+        return _entries.size();
+    }
+
+    /// Gets the key value pairs of a tenant
+    /// \param tenant the tenant
+    /// \return all key value pairs of the tenant
+    std::unordered_map<KeyType, ValueType> key_value_pairs(uint64_t tenant) const {
+        std::unordered_map<KeyType, ValueType> result;
+        auto range = _entries.equal_range(tenant);
+        for (auto entry = range.first; entry != range.second; ++entry)
+            result.emplace(entry->first.second, entry->second.reg.value());
+
+        return result;
+    }
+
+    /// Gets a delta of the registry for a tenant, i.e., a registry holding only the keys of the tenant with their
+    /// registers, and whose causal context holds only the dots of their tags (see ORSet::delta). Deltas of many
+    /// tenants are merged into one registry to ship them in a single stream; removes are not covered by deltas.
+    /// \param tenant the tenant
+    /// \return the delta
+    MapRegistry<KeyType, ValueType, Replicas, Stamp> delta(uint64_t tenant) const {
+        MapRegistry<KeyType, ValueType, Replicas, Stamp> result(_replica_id);
+        auto range = _entries.equal_range(tenant);
+        for (auto entry = range.first; entry != range.second; ++entry) {
+            for (const auto& tag: entry->second.tags)
+                result._context.add(tag.first, tag.second);
+            result._entries.emplace_hint(result._entries.end(), *entry);
+        }//for
+
+        return result;
+    }
+
+    /// Merges a remote registry with the local registry, i.e., the map of each tenant with the map of the tenant
+    /// in the remote registry. The entries of both registries are walked in order in a single pass.
+    /// \param remote the remote registry
+    void merge(const MapRegistry<KeyType, ValueType, Replicas, Stamp>& remote) {
+        auto local_entry = _entries.begin();
+        auto remote_entry = remote._entries.begin();
+        EntryOrder order;
+        while (local_entry != _entries.end() or remote_entry != remote._entries.end()) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            if (remote_entry == remote._entries.end() or
+                (local_entry != _entries.end() and order(local_entry->first, remote_entry->first))) {
+                // The entry does not exist remotely
+                if (_removed_remotely(local_entry->second.tags, remote._context)) {
+                    local_entry = _entries.erase(local_entry);
+                    CRDTS_COUNT(ELEMENTS_ERASED, 1);
+                }//if
+                else {
+                    ++local_entry;
+                }//else
+            }//if
+            else if (local_entry == _entries.end() or order(remote_entry->first, local_entry->first)) {
+                // The entry does not exist locally
+                if (_added_remotely(remote_entry->second.tags))
+                    _insert_entry(local_entry, *remote_entry);
+                ++remote_entry;
+            }//else if
+            else {
+                _merge_entry(local_entry->second, remote_entry->second);
+                ++local_entry;
+                ++remote_entry;
+            }//else
+        }//while
+
+        CRDTS_PHASE(VERSIONS);
+        _context.join(remote._context);
+    }
+
+    /// Merges a delta of the registry (see delta), or a batch of deltas, with the local registry. Only the entries
+    /// of the delta are visited, each found in the tree, so merging the delta of a tenant does not walk the entries
+    /// of other tenants. A delta does not carry removes, so no local entry is removed.
+    /// \param delta the delta
+    void merge_delta(const MapRegistry<KeyType, ValueType, Replicas, Stamp>& delta) {
+        EntryOrder order;
+        for (const auto& remote_entry: delta._entries) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            auto local_entry = _entries.lower_bound(remote_entry.first);
+            if (local_entry != _entries.end() and !order(remote_entry.first, local_entry->first))
+                _merge_entry(local_entry->second, remote_entry.second);
+            else if (_added_remotely(remote_entry.second.tags))
+                _insert_entry(local_entry, remote_entry);
+        }//for
+
+        CRDTS_PHASE(VERSIONS);
+        _context.join(delta._context);
+    }
+
+    /// Gets the local replica id
+    /// \return the local replica id
+    uint64_t replica_id() const {
+        return _replica_id;
+    }
+
+    /// Gets the causal context shared by the maps of all tenants
+    /// \return the causal context
+    const Context& context() const {
+        return _context;
+    }
+
+    /// Gets the memory footprint of the registry: tenants and keys are keys, and tags, timestamps, and the causal
+    /// context are metadata. The nodes of the tree, i.e., three pointers and a color each, are overhead.
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        auto usage = _context.memory_usage();
+        for (const auto& entry: _entries) {
+            usage.keys += sizeof(uint64_t) + footprint(entry.first.second);
+            usage += tags_memory_usage(entry.second.tags);
+            usage += entry.second.reg.memory_usage();
+            usage.overhead += 4 * sizeof(void*);
+        }//for
+
+        return usage;
+    }
+
+    /// Writes the state of the registry, i.e., its causal context, the clock of its timestamps, and the entries of
+    /// all tenants, to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _replica_id);
+        _context.serialize(out);
+        Serializer<uint64_t>::write(out, _clock);
+
+        Serializer<uint64_t>::write(out, _entries.size());
+        for (const auto& entry: _entries) {
+            Serializer<uint64_t>::write(out, entry.first.first);
+            Serializer<KeyType>::write(out, entry.first.second);
+            Serializer<uint64_t>::write(out, entry.second.tags.size());
+            for (const auto& tag: entry.second.tags) {
+                Serializer<uint64_t>::write(out, tag.first);
+                Serializer<uint64_t>::write(out, tag.second);
+            }//for
+            entry.second.reg.serialize(out);
+        }//for
+    }
+
+    /// Replaces the state of the registry with a state written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the state was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        uint64_t replica_id, clock, entries;
+        Context context;
+        if (!Serializer<uint64_t>::read(in, replica_id) or !ReplicaTraits<Replicas>::valid(replica_id) or
+            !context.deserialize(in, Replicas) or !Serializer<uint64_t>::read(in, clock) or
+            !Serializer<uint64_t>::read(in, entries))
+            return false;
+
+        Entries entries_read;
+        for (uint64_t i = 0; i < entries; ++i) {
+            uint64_t tenant, tags;
+            KeyType key;
+            if (!Serializer<uint64_t>::read(in, tenant) or !Serializer<KeyType>::read(in, key) or
+                !Serializer<uint64_t>::read(in, tags))
+                return false;
+
+            auto& entry = entries_read[std::make_pair(tenant, std::move(key))];
+            for (uint64_t j = 0; j < tags; ++j) {
+                uint64_t id;
+                if (!Serializer<uint64_t>::read(in, id) or !ReplicaTraits<Replicas>::valid(id) or
+                    !Serializer<uint64_t>::read(in, entry.tags[id]))
+                    return false;
+            }//for
+            if (!entry.reg.deserialize(in))
+                return false;
+        }//for
+
+        this->_replica_id = replica_id;
+        this->_context = context;
+        this->_clock = clock;
+        this->_entries.swap(entries_read);
+        return true;
+    }
+};
+
+#endif //CRDTS_MAP_REGISTRY_HH
@@ -1,82 +1,197 @@
 #ifndef CRDTS_ORSET_HH
 #define CRDTS_ORSET_HH
 
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
-#include "../core/timestamp.hh"
+#include <utility>
+#include <vector>
+#include "../core/bloom_filter.hh"
+#include "../core/causal_context.hh"
+#include "../core/containers.hh"
+#include "../core/instrumentation.hh"
+#include "../core/replicas.hh"
+#include "../core/serializer.hh"
+
+template<typename ValueType> class DurableORSet;
+template<typename KeyType, typename ValueType> class DurableMap;
+template<typename KeyType, typename ValueType> class TieredMap;
+template<typename ValueType, size_t Replicas, typename Containers> class ORSetMerge;
 
 /// ORSet implements an "observed remove set" based on "optimized observed removed set" [1].
 /// [1] Bieniusa A, Zawirski M, Preguiça N, Shapiro M, Baquero C, Balegas V, Duarte S. (2012).
 /// An optimized conflict-free replicated set, arXiv preprint arXiv:1210.3368.
-template<typename ValueType>
+///
+/// Replicas is the number of replicas if it is known at compile time, in which case replica identifiers must
+/// be 0 to Replicas - 1, and tags and the causal context are stored in arrays (see ReplicaTraits). The default,
+/// 0, allows any number of replicas with arbitrary identifiers. Containers is the policy that selects the hash
+/// table of elements and the key type of lookups (see StdContainers and FlatContainers).
+///
+/// A set can keep a summary of its elements, a Bloom filter that is updated as elements are added (see
+/// enable_summary). The summary answers most lookups of missing elements without probing the table of elements,
+/// saves probing a remote set for local elements it does not hold in merges, and lets two replicas sync by
+/// exchanging their causal contexts and summaries instead of their states (see sync_state and merge_sync).
+template<typename ValueType, size_t Replicas = 0, typename Containers = StdContainers>
 class ORSet {
+    friend class DurableORSet<ValueType>;
+    template<typename, typename> friend class DurableMap;
+    template<typename, typename> friend class TieredMap;
+    template<typename, typename, size_t, typename, typename> friend class Map;
+    friend class ORSetMerge<ValueType, Replicas, Containers>;
+
+public:
+    // The type of elements accepted by lookups, e.g., std::string_view for std::string elements in flat tables
+    using Lookup = typename Containers::template Lookup<ValueType>;
+    using Context = typename ReplicaTraits<Replicas>::Context;
+
 private:
-    std::unordered_map<ValueType, std::unordered_map<uint64_t, Timestamp>> _elements;
-    std::unordered_map<uint64_t, Timestamp> _versions;
+    // The tags of an element: the sequence number of the latest add of the element at each replica
+    using Tags = typename ReplicaTraits<Replicas>::Tags;
+    using Elements = typename Containers::template Map<ValueType, Tags>;
+
+    Elements _elements;
+    Context _context; // The add operations observed by the local replica
     uint64_t _replica_id;
+    // The hash codes of added elements if the summary is enabled, otherwise an empty filter. Each element is
+    // inserted when it enters the table of elements, so the filter holds more hash codes than there are
+    // elements only if elements have been removed since it was built.
+    BloomFilter _summary;
 
-    /// Merges the local version vector with a given set
+    // The number of local elements merged together with each remote set in merge_all
+    static const size_t MERGE_ALL_BLOCK = 256;
+
+    /// Gets the hash code of an element in the summary
+    template<typename Element>
+    static uint64_t _hash(const Element& e) {
+        return FlatHash()(e);
+    }
+
+    /// Rebuilds the summary from the elements, sized for twice their number
+    void _rebuild_summary() {
+        _summary = BloomFilter(2 * _elements.size(), _summary.bits_per_hash());
+        for (const auto& elem: _elements)
+            _summary.insert(_hash(elem.first));
+    }
+
+    /// Makes room for a given number of elements, so adding up to that number neither rehashes the table of
+    /// elements nor rebuilds the summary, e.g., before an incremental merge adds remote elements in steps
+    /// \param size the number of elements
+    void _reserve(size_t size) {
+        _elements.reserve(size);
+        if (!_summary.empty() and size > _elements.size() and
+            _summary.inserted() + (size - _elements.size()) > _summary.capacity()) {
+            _summary = BloomFilter(2 * size, _summary.bits_per_hash());
+            for (const auto& elem: _elements)
+                _summary.insert(_hash(elem.first));
+        }//if
+    }
+
+    /// Inserts an element that has entered the table of elements into the summary, if the summary is enabled
+    /// \param e the element
+    void _summarize(const ValueType& e) {
+        if (!_summary.empty())
+            _summarize_hash(_hash(e));
+    }
+
+    /// Inserts the hash code of an element that has entered the table of elements into the enabled summary. A
+    /// full summary is rebuilt from the table instead, so the element must be in the table before.
+    /// \param hash the hash code of the element
+    void _summarize_hash(uint64_t hash) {
+        if (_summary.full())
+            _rebuild_summary();
+        else
+            _summary.insert(hash);
+    }
+
+    /// Checks if a remote set does not hold a given element; the summary of the remote set, if it is enabled,
+    /// rules out most elements it does not hold without probing its elements
+    /// \param e the element
+    /// \param remote_set the remote set
+    /// \return true if the remote set does not hold the element, otherwise false
+    static bool _absent_remotely(const ValueType& e, const ORSet<ValueType, Replicas, Containers>& remote_set) {
+        if (!remote_set._summary.may_contain(_hash(e)))
+            return true;
+
+        CRDTS_COUNT(HASH_PROBES, 1);
+        return remote_set._elements.count(e) == 0;
+    }
+
+    /// Merges the local causal context with that of a given set
     /// \param remote_set the given set
-    void _merge_versions(const ORSet<ValueType>& remote_set) {
-        for (const auto& v: remote_set._versions) {
-            auto local_version = this->_versions.find(v.first);
+    void _merge_versions(const ORSet<ValueType, Replicas, Containers>& remote_set) {
+        CRDTS_PHASE(VERSIONS);
+        this->_context.join(remote_set._context);
+    }
 
-            if (local_version != this->_versions.end()) {
-                // Local replica has observed the version of this remote replica
-                local_version->second = std::max(local_version->second, v.second);
+    /// Checks if a local element that does not exist in a given remote set has been removed remotely.
+    /// Only remove operations that are more recent than observed add operations are effective.
+    /// \param local_tags the tags of the local element
+    /// \param remote_set the remote set object
+    /// \return true if the element has been removed remotely, otherwise false
+    static bool _removed_remotely(const Tags& local_tags, const ORSet<ValueType, Replicas, Containers>& remote_set) {
+        // Applying the add wins policy: find a concurrent or newer add
+        for (const auto& local_add: local_tags) {
+            if (!remote_set._context.contains(local_add.first, local_add.second)) {
+                // A concurrent or newer local add exists, so the remote remove is not newer
+                // based on ``add wins'' policy
+                return false;
             }//if
-            else {
-                // Local replica has not observed the version of this remote replica
-                this->_versions[v.first] = v.second;
-            }//else
         }//for
+
+        // Find an evidence that there has been a remote remove by examining the versions
+        // of replicas observed in the remote set
+        for (const auto &remote_remove: remote_set._context) {
+            auto local_add = local_tags.find(remote_remove.first);
+            // An evidence would be that a sequence number associated to a replica id
+            // has not been seen locally or this sequence number is newer than an locally observed one
+            if (local_add == local_tags.end() or local_add->second < remote_remove.second.max()) {
+                // An evidence is found
+                return true;
+            }//if
+        }//for
+
+        return false;
     }
 
     /// Applies remove operations from a given remote set, only operations that are more recent than
     /// observed add operations are effective.
     /// \param remote_set the remote set object
-    void _apply_remote_removes(const ORSet<ValueType>& remote_set) {
+    void _apply_remote_removes(const ORSet<ValueType, Replicas, Containers>& remote_set) {
+        CRDTS_PHASE(REMOVES);
         // Remove elements that have been removed remotely.
         // Add wins policy is applied for concurrent add and remove operations
         for (auto local_elem = this->_elements.begin(); local_elem != this->_elements.end(); /* no increment here */) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
             // An element has been removed remotely if it does not exist in the remote set.
-            if (remote_set._elements.count(local_elem->first) == 0) {
-                // Applying the add wins policy: find a concurrent or newer add
-                bool newer_remote_remove = true;
-                for (const auto& local_add: local_elem->second) {
-                    auto remote_remove = remote_set._versions.find(local_add.first);
-
-                    if (remote_remove == remote_set._versions.end() or remote_remove->second < local_add.second) {
-                        // A concurrent or newer local add exists, so the remote remove is not newer
-                        // based on ``add wins'' policy
-                        newer_remote_remove = false;
-                        break;
-                    }//if
-                }//for
-
-                if (newer_remote_remove) {
-                    // Find an evidence that there has been a remote remove by examining the versions
-                    // of replicas observed in the remote set
-                    newer_remote_remove = false;
-                    for (const auto &remote_remove: remote_set._versions) {
-                        auto local_add = local_elem->second.find(remote_remove.first);
-                        // An evidence would be that a timestamp associated to a replica id
-                        // has not been seen locally or this timestamp is newer than an locally observed timestamp
-                        if (local_add == local_elem->second.end() or local_add->second < remote_remove.second) {
-                            // An evidence is found
-                            newer_remote_remove = true;
-                            break;
-                        }//if
-                    }//for
-                }//if
+            if (_absent_remotely(local_elem->first, remote_set) and _removed_remotely(local_elem->second, remote_set)) {
+                // Remove the element that has been remotely removed, and move to next local element
+                local_elem = this->_elements.erase(local_elem);
+                CRDTS_COUNT(ELEMENTS_ERASED, 1);
+            }//if
+            else {
+                ++local_elem;
+            }//else
+        }//for
+    }
 
-                if (newer_remote_remove) {
-                    // Remove the element that has been remotely removed, and move to next local element
-                    local_elem = this->_elements.erase(local_elem);
-                }//if
-                else {
-                    ++local_elem;
-                }//else
+    /// Applies remove operations from the state of a remote set returned by sync_state, see merge_sync
+    /// \param remote_state the state of the remote set
+    /// \param remote_summary the summary of the remote set
+    void _apply_synced_removes(const ORSet<ValueType, Replicas, Containers>& remote_state,
+                               const BloomFilter& remote_summary) {
+        CRDTS_PHASE(REMOVES);
+        for (auto local_elem = this->_elements.begin(); local_elem != this->_elements.end(); /* no increment here */) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            CRDTS_COUNT(HASH_PROBES, 1);
+            if (remote_state._elements.count(local_elem->first) == 0 and
+                !remote_summary.may_contain(_hash(local_elem->first)) and
+                _removed_remotely(local_elem->second, remote_state)) {
+                local_elem = this->_elements.erase(local_elem);
+                CRDTS_COUNT(ELEMENTS_ERASED, 1);
             }//if
             else {
                 ++local_elem;
@@ -84,82 +199,338 @@ private:
         }//for
     }
 
+    /// Checks if a tag has not been observed in a given causal context
+    /// \param context the given causal context
+    /// \param tag the sequence number associated to a replica id
+    /// \return true if the tag is not in the context, otherwise false
+    template<typename Tag>
+    static bool _unobserved(const Context& context, const Tag& tag) {
+        return !context.contains(tag.first, tag.second);
+    }
+
+    /// Merges the tags of a remote element with the tags of an element that exists locally
+    /// \param local_tags the tags of the local element
+    /// \param remote_tags the tags of the remote element
+    /// \param context the local causal context
+    static void _update_tags(Tags& local_tags, const Tags& remote_tags, const Context& context) {
+        for (const auto& remote_timestamp: remote_tags) {
+            // Update a local timestamp with a remote timestamp that is more recent
+            if (_unobserved(context, remote_timestamp)) {
+                local_tags[remote_timestamp.first] = remote_timestamp.second;
+                CRDTS_COUNT(STAMPS_UPDATED, 1);
+            }//if
+        }//for
+    }
+
+    /// Checks if a remote element that does not exist locally must be added
+    /// \param remote_tags the tags of the remote element
+    /// \param context the local causal context
+    /// \return true if the remote element has been added after the local replica observed it, otherwise false
+    static bool _added_remotely(const Tags& remote_tags, const Context& context) {
+        for (const auto& remote_timestamp: remote_tags) {
+            // Check if a remote timestamp is newer than the local timestamp
+            // A single newer remote timestamp is sufficient due to the ``add wins'' policy
+            if (_unobserved(context, remote_timestamp))
+                return true;
+        }//for
+
+        return false;
+    }
+
+    /// Applies add operations of a given remote element with add-wins policy. A remote element is not added
+    /// if the local replica has received and then removed the element earlier.
+    /// \param e the remote element
+    /// \param remote_tags the tags of the remote element
+    void _apply_remote_add(const ValueType& e, const Tags& remote_tags) {
+        CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+        CRDTS_COUNT(HASH_PROBES, 1);
+        auto local_elem = this->_elements.find(e);
+
+        // Check if the remote_set element locally exists
+        if (local_elem != this->_elements.end()) {
+            // The element already exists, update the timestamps
+            _update_tags(local_elem->second, remote_tags, this->_context);
+        }//if
+        else if (_added_remotely(remote_tags, this->_context)) {
+            // Add a new element that was added remotely
+            this->_elements[e] = remote_tags;
+            _summarize(e);
+            CRDTS_COUNT(ELEMENTS_ADDED, 1);
+        }//else if
+    }
+
+    /// Merges an element with a remote set as merge does, given the causal context observed before the merge
+    /// \param e the element
+    /// \param tags the tags of the element, which are updated
+    /// \param exists true if the element exists before the merge, otherwise false
+    /// \param remote_set the remote set
+    /// \param observed the causal context observed before the merge
+    /// \return true if the element exists after the merge, otherwise false
+    static bool _merge_element(const ValueType& e, Tags& tags, bool exists,
+                               const ORSet<ValueType, Replicas, Containers>& remote_set, const Context& observed) {
+        CRDTS_COUNT(HASH_PROBES, 1);
+        auto remote_elem = remote_set._elements.find(e);
+        if (remote_elem == remote_set._elements.end()) {
+            if (exists and _removed_remotely(tags, remote_set)) {
+                tags.clear();
+                return false;
+            }//if
+        }//if
+        else if (exists) {
+            _update_tags(tags, remote_elem->second, observed);
+        }//else if
+        else if (_added_remotely(remote_elem->second, observed)) {
+            tags = remote_elem->second;
+            return true;
+        }//else if
+
+        return exists;
+    }
+
     /// Applies add operations from a given remote set with add-wins policy
     /// \param remote_set the given remote set
-    void _apply_remote_adds(const ORSet<ValueType>& remote_set) {
-        // Add remote elements locally. A remote element is not added if the local replica has received and then
-        // removed the element earlier.
-        for (const auto& remote_elem: remote_set._elements) {
-            auto local_elem = this->_elements.find(remote_elem.first);
+    void _apply_remote_adds(const ORSet<ValueType, Replicas, Containers>& remote_set) {
+        CRDTS_PHASE(ADDS);
+        // Add remote elements locally.
+        for (const auto& remote_elem: remote_set._elements)
+            _apply_remote_add(remote_elem.first, remote_elem.second);
+    }
 
-            // Check if the remote_set element locally exists
+    /// Applies add operations from a given remote set with add-wins policy, moving the nodes of added elements
+    /// from the remote set
+    /// \param remote_set the given remote set
+    void _apply_remote_adds(ORSet<ValueType, Replicas, Containers>&& remote_set) {
+        CRDTS_PHASE(ADDS);
+        auto& remote_elements = remote_set._elements;
+        for (auto remote_elem = remote_elements.begin(); remote_elem != remote_elements.end(); /* no increment */) {
+            // Extracting a node only invalidates the iterator to that node
+            auto next = std::next(remote_elem);
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            CRDTS_COUNT(HASH_PROBES, 1);
+            auto local_elem = this->_elements.find(remote_elem->first);
             if (local_elem != this->_elements.end()) {
-                // The element already exists, update the timestamps
-                for (auto remote_timestamp: remote_elem.second) {
-                    // Update a local timestamp with a remote timestamp that is more recent
-                    if (this->_versions.count(remote_timestamp.first) == 0 or
-                        this->_versions[remote_timestamp.first] < remote_timestamp.second) {
-                        local_elem->second[remote_timestamp.first] = remote_timestamp.second;
-                    }//if
-                }//for
+                _update_tags(local_elem->second, remote_elem->second, this->_context);
             }//if
-            else {
-                // The element does not exist locally
-                bool more_recent = false;
-                for (auto remote_timestamp: remote_elem.second) {
-                    // Check if a remote timestamp is newer than the local timestamp
-                    // A single newer remote timestamp is sufficient due to the ``add wins'' policy
-                    if (this->_versions.count(remote_timestamp.first) == 0 or
-                        this->_versions[remote_timestamp.first] < remote_timestamp.second) {
-                        more_recent = true;
-                        break;
+            else if (_added_remotely(remote_elem->second, this->_context)) {
+                // The element moves with its node, so its hash code is taken before and summarized after the node
+                // enters the table
+                auto hash = _summary.empty() ? 0 : _hash(remote_elem->first);
+                this->_elements.insert(remote_elements.extract(remote_elem));
+                if (!_summary.empty())
+                    _summarize_hash(hash);
+                CRDTS_COUNT(ELEMENTS_ADDED, 1);
+            }//else if
+            remote_elem = next;
+        }//for
+    }
+
+    /// Tags a local add of an element with the next sequence number of the local replica
+    /// \param tags the tags of the element
+    void _tag(Tags& tags) {
+        CRDTS_COUNT(OPERATIONS, 1);
+        auto seq_number = _context.max(_replica_id) + 1;
+        _context.add(_replica_id, seq_number);
+        tags[_replica_id] = seq_number;
+    }
+
+    /// Merges the local set with several remote sets, see merge_all
+    /// \param remote_sets the given remote sets
+    /// \param restarts if not null, receives each element that exists after the merge but not after merging one
+    /// of the remote sets one by one, with the index of the first remote set since which it exists
+    template<typename Restarts>
+    void _merge_all(const std::vector<const ORSet<ValueType, Replicas, Containers>*>& remote_sets,
+                    Restarts* restarts) {
+        if (remote_sets.empty())
+            return;
+
+        // The causal contexts that merging the remote sets one by one would observe before each remote set
+        std::vector<Context> observed(1, this->_context);
+        observed.reserve(remote_sets.size());
+        for (size_t i = 0; i + 1 < remote_sets.size(); ++i) {
+            observed.push_back(observed.back());
+            observed.back().join(remote_sets[i]->_context);
+        }//for
+
+        // Merge elements that do not exist locally, starting from the first remote set that may add each element.
+        // A remote set whose causal context has been observed cannot add elements, so it is skipped.
+        std::vector<bool> adds(remote_sets.size(), false);
+        std::vector<std::pair<const ValueType*, Tags>> added;
+        for (size_t i = 0; i < remote_sets.size(); ++i) {
+            adds[i] = !observed[i].includes(remote_sets[i]->_context);
+            if (!adds[i])
+                continue;
+
+            for (const auto& remote_elem: remote_sets[i]->_elements) {
+                CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+                CRDTS_COUNT(HASH_PROBES, 1);
+                if (this->_elements.count(remote_elem.first) > 0)
+                    continue;
+
+                bool merged = false;
+                for (size_t j = 0; j < i and !merged; ++j)
+                    merged = adds[j] and remote_sets[j]->_elements.count(remote_elem.first) > 0;
+                if (merged)
+                    continue;
+
+                Tags tags;
+                bool exists = false;
+                size_t since = i;
+                for (size_t j = i; j < remote_sets.size(); ++j) {
+                    bool existed = exists;
+                    exists = _merge_element(remote_elem.first, tags, exists, *remote_sets[j], observed[j]);
+                    if (exists and !existed)
+                        since = j;
+                }//for
+                if (exists) {
+                    added.emplace_back(&remote_elem.first, std::move(tags));
+                    if (restarts)
+                        restarts->emplace(remote_elem.first, since);
+                }//if
+            }//for
+        }//for
+
+        // Merge local elements. Local elements are merged in blocks, and each block is merged with the remote
+        // sets one by one, so probing a remote set follows the order of local elements.
+        std::vector<typename Elements::iterator> block;
+        std::vector<bool> exists;
+        std::vector<size_t> since; // The index of the first remote set since which an element exists
+        for (auto local_elem = this->_elements.begin(); local_elem != this->_elements.end(); /* no increment here */) {
+            block.clear();
+            for (; local_elem != this->_elements.end() and block.size() < MERGE_ALL_BLOCK; ++local_elem)
+                block.push_back(local_elem);
+            CRDTS_COUNT(ELEMENTS_SCANNED, block.size());
+
+            exists.assign(block.size(), true);
+            since.assign(block.size(), 0);
+            for (size_t i = 0; i < remote_sets.size(); ++i) {
+                for (size_t j = 0; j < block.size(); ++j) {
+                    if (exists[j] or adds[i]) {
+                        bool existed = exists[j];
+                        exists[j] = _merge_element(block[j]->first, block[j]->second, exists[j],
+                                                   *remote_sets[i], observed[i]);
+                        if (exists[j] and !existed)
+                            since[j] = i;
                     }//if
                 }//for
+            }//for
 
-                // Add a new element that was added remotely
-                if (more_recent) {
-                    this->_elements[remote_elem.first] = remote_elem.second;
+            for (size_t j = 0; j < block.size(); ++j) {
+                if (!exists[j]) {
+                    this->_elements.erase(block[j]);
+                    CRDTS_COUNT(ELEMENTS_ERASED, 1);
                 }//if
-            }//else
+                else if (since[j] > 0 and restarts) {
+                    restarts->emplace(block[j]->first, since[j]);
+                }//else if
+            }//for
+        }//for
+
+        for (auto& elem: added) {
+            this->_elements.emplace(*elem.first, std::move(elem.second));
+            _summarize(*elem.first);
         }//for
+        CRDTS_COUNT(ELEMENTS_ADDED, added.size());
+
+        // Merge versions
+        this->_context.swap(observed.back());
+        this->_context.join(remote_sets.back()->_context);
     }
 
 public:
     /// Creates an ORSet object at a replica identified with a given id
     /// \param replica_id the given replica id
     explicit ORSet(uint64_t replica_id) {
+        if (!ReplicaTraits<Replicas>::valid(replica_id))
+            throw std::out_of_range("replica id " + std::to_string(replica_id) + " exceeds the number of replicas");
+
         this->_replica_id = replica_id;
         // Initialize the local version
-        this->_versions[_replica_id].replica_id(this->_replica_id);
+        this->_context.add_replica(_replica_id);
     }
 
     /// Adds a given element to the set
     /// \param e the given element
     void add(const ValueType& e) {
-        _versions[_replica_id].update();
-        _elements[e][_replica_id] = _versions[_replica_id];
+        auto elem = _elements.try_emplace(e);
+        _tag(elem.first->second);
+        if (elem.second)
+            _summarize(elem.first->first);
+    }
+    void add(ValueType&& e) {
+        auto elem = _elements.try_emplace(std::move(e));
+        _tag(elem.first->second);
+        if (elem.second)
+            _summarize(elem.first->first);
+    }
+
+    /// Adds an element constructed in place from given arguments; the element is not constructed
+    /// separately from its node
+    /// \param args the arguments of the constructor of the element
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        auto elem = _elements.emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<Args>(args)...),
+                                      std::forward_as_tuple());
+        _tag(elem.first->second);
+        if (elem.second)
+            _summarize(elem.first->first);
     }
-    void add(const ValueType&& e) { add(e); }
 
     /// Removes a given element from the set
     /// \param e the given element
     /// \return true if the given element existed and was removed, otherwise false
     bool remove(const ValueType& e) {
+        CRDTS_COUNT(OPERATIONS, 1);
         return _elements.erase(e) > 0;
     }
-    bool remove(const ValueType&& e) { return remove(e); }
+
+    /// Removes all elements from the set. The causal context is kept, so the adds of the elements are observed
+    /// as removed, and later adds are tagged with new sequence numbers.
+    void clear() {
+        CRDTS_COUNT(OPERATIONS, 1);
+        _elements.clear();
+    }
+
+    /// Gets the greatest sequence number that the replica has tagged an add with
+    /// \return the sequence number, 0 if the replica has not added any element
+    uint64_t clock() const {
+        return _context.max(_replica_id);
+    }
+
+    /// Ensures that later adds are tagged with sequence numbers greater than a given sequence number. The adds of
+    /// the replica up to it are observed, so merges take their elements as removed, e.g., the elements of the value
+    /// of a removed key of a Map that other replicas still hold.
+    /// \param seq_number the given sequence number
+    void advance(uint64_t seq_number) {
+        _context.add_prefix(_replica_id, seq_number);
+    }
 
     /// Check if the given element exists in the set
     /// \param e the given element
     /// \return true if the given element exists, otherwise false
-    bool contains(const ValueType& e) {
-        return _elements.count(e) > 0;
+    bool contains(Lookup e) const {
+        return _summary.may_contain(_hash(e)) and _elements.count(e) > 0;
+    }
+
+    /// Checks if several elements exist in the set. Flat tables prefetch the slots of a batch of elements
+    /// before probing them, which hides most cache misses of lookups in a large set.
+    /// \param elements the elements, which must have the element type unless lookups take them by value
+    /// \return a vector holding true for each element that exists, otherwise false
+    template<typename Element>
+    std::vector<bool> contains_many(const std::vector<Element>& elements) const {
+        static_assert(std::is_same<Element, ValueType>::value or !std::is_reference<Lookup>::value,
+                      "elements must have the element type");
+        std::vector<bool> result(elements.size());
+        find_many(_elements, elements.size(), [&elements](size_t i) -> Lookup { return elements[i]; },
+                  [this, &result](size_t i, typename Elements::const_iterator elem) {
+                      result[i] = elem != _elements.end();
+                  });
+
+        return result;
     }
-    bool contains(const ValueType&& e) { return contains(e); }
 
     /// Merges the local set with a given remote set
     /// \param remote_set the given remote set
-    void merge(const ORSet<ValueType>& remote_set) {
+    void merge(const ORSet<ValueType, Replicas, Containers>& remote_set) {
         // apply remote remove operations
         _apply_remote_removes(remote_set);
 
@@ -170,6 +541,117 @@ public:
         _merge_versions(remote_set);
     }
 
+    /// Merges the local set with a given remote set that is no longer needed. Elements added remotely are moved
+    /// from the remote set instead of being copied; the remote set is left in a valid but unspecified state.
+    /// \param remote_set the given remote set
+    void merge(ORSet<ValueType, Replicas, Containers>&& remote_set) {
+        // apply remote remove operations
+        _apply_remote_removes(remote_set);
+
+        // apply remote add operations
+        _apply_remote_adds(std::move(remote_set));
+
+        // merge versions
+        _merge_versions(remote_set);
+    }
+
+    /// Merges the local set with several remote sets in a single pass over local elements. The result is the
+    /// same as merging the remote sets one by one in the given order, but causal contexts are joined once, the
+    /// add-wins policy of each element is evaluated against all remote sets at once, and remote sets whose
+    /// causal contexts have been observed are not scanned for new elements.
+    ///
+    /// merge_all saves the repeated scans of local elements and joins of causal contexts of sequential merges,
+    /// not the reads of remote sets: each local element is still looked up once in each remote set that has not
+    /// ruled it out, so merging k sets of n elements costs O(k n) lookups as sequential merges do. It is faster
+    /// than sequential merges mostly when remote sets are behind the local set.
+    /// \param remote_sets the given remote sets
+    void merge_all(const std::vector<const ORSet<ValueType, Replicas, Containers>*>& remote_sets) {
+        _merge_all(remote_sets, static_cast<typename Containers::template Map<ValueType, size_t>*>(nullptr));
+    }
+
+    /// Merges the local set with a range of remote sets, see merge_all
+    /// \param first the iterator to the first remote set
+    /// \param last the iterator past the last remote set
+    template<typename Iterator>
+    void merge_all(Iterator first, Iterator last) {
+        std::vector<const ORSet<ValueType, Replicas, Containers>*> remote_sets;
+        for (; first != last; ++first)
+            remote_sets.push_back(&*first);
+
+        merge_all(remote_sets);
+    }
+
+    /// Gets a delta of the set for a given element, i.e., a set holding only the element with its tags, and whose
+    /// causal context holds only the dots of these tags. Merging the delta adds the element as merging the set
+    /// would, and does not remove other elements, since none of them has all of its tags in the delta.
+    /// \param e the given element
+    /// \return the delta, which is empty if the element does not exist
+    ORSet<ValueType, Replicas, Containers> delta(const ValueType& e) const {
+        ORSet<ValueType, Replicas, Containers> result(_replica_id);
+        auto elem = _elements.find(e);
+        if (elem != _elements.end()) {
+            for (const auto& tag: elem->second)
+                result._context.add(tag.first, tag.second);
+            result._elements.emplace(elem->first, elem->second);
+        }//if
+
+        return result;
+    }
+
+    /// Enables the summary of the set, a Bloom filter of its elements that is kept up to date as elements are
+    /// added. Lookups of most missing elements then skip the table of elements, and merges into other sets skip
+    /// probing this set for most of their elements that it does not hold.
+    /// \param bits_per_element the number of bits per element, which sets the rate of false positives
+    void enable_summary(uint32_t bits_per_element = 10) {
+        _summary = BloomFilter(1, bits_per_element);
+        _rebuild_summary();
+    }
+
+    /// Gets the summary of the set for a sync (see merge_sync). The summary is rebuilt first if elements have
+    /// been removed since it was built, so that removed elements do not look present to the remote replica.
+    /// \return the summary, which is empty if the summary is not enabled
+    const BloomFilter& summary() {
+        if (!_summary.empty() and _summary.inserted() != _elements.size())
+            _rebuild_summary();
+
+        return _summary;
+    }
+
+    /// Gets the part of the state that a remote replica with a given causal context has not observed: the
+    /// elements with a tag the remote replica has not observed, and the whole causal context. The remote
+    /// replica sends its causal context, and gets this state with the summary of the set (see merge_sync).
+    /// \param remote_context the causal context of the remote replica
+    /// \return the state, which holds no element if the remote replica has observed every add
+    ORSet<ValueType, Replicas, Containers> sync_state(const Context& remote_context) const {
+        ORSet<ValueType, Replicas, Containers> result(_replica_id);
+        result._context = _context;
+        for (const auto& elem: _elements) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            for (const auto& tag: elem.second) {
+                if (_unobserved(remote_context, tag)) {
+                    result._elements.emplace(elem.first, elem.second);
+                    break;
+                }//if
+            }//for
+        }//for
+
+        return result;
+    }
+
+    /// Merges the local set with the state of a remote set returned by sync_state for the local causal context,
+    /// given the summary of the remote set taken with that state. Adds are merged as merge does. A local element
+    /// missing from the state is one the remote set either holds with tags that are observed locally, or does not
+    /// hold; the summary tells most of the latter apart, and these elements are removed if they have been removed
+    /// remotely. A false positive of the summary only defers a remove to a later sync or merge, and an empty
+    /// summary defers all removes.
+    /// \param remote_state the state of the remote set
+    /// \param remote_summary the summary of the remote set
+    void merge_sync(const ORSet<ValueType, Replicas, Containers>& remote_state, const BloomFilter& remote_summary) {
+        _apply_synced_removes(remote_state, remote_summary);
+        _apply_remote_adds(remote_state);
+        _merge_versions(remote_state);
+    }
+
     /// Gets elements stored in the local replica
     /// \return the set of elements
     std::unordered_set<ValueType> elements() const {
@@ -183,15 +665,87 @@ public:
 
     /// Gets the local replica id
     /// \return the local replica id
-    uint64_t replica_id() {
+    uint64_t replica_id() const {
         return _replica_id;
     }
 
     /// Gets the number of elements in the set
     /// \return the number of elements
-    size_t size() {
+    size_t size() const {
         return _elements.size();
     }
+
+    /// Gets the causal context, i.e., the add operations observed by the local replica
+    /// \return the causal context
+    const Context& context() const {
+        return _context;
+    }
+
+    /// Gets the memory footprint of the set: elements are keys, and tags, the causal context and the summary are
+    /// metadata
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        auto usage = _context.memory_usage();
+        usage += _summary.memory_usage();
+        usage.overhead += hash_table_overhead(_elements);
+        for (const auto& elem: _elements) {
+            usage.keys += footprint(elem.first);
+            usage += tags_memory_usage(elem.second);
+        }//for
+
+        return usage;
+    }
+
+    /// Writes the state of the set, i.e., its elements with their tags and its causal context, to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _replica_id);
+        _context.serialize(out);
+
+        Serializer<uint64_t>::write(out, _elements.size());
+        for (const auto& elem: _elements) {
+            Serializer<ValueType>::write(out, elem.first);
+            Serializer<uint64_t>::write(out, elem.second.size());
+            for (const auto& tag: elem.second) {
+                Serializer<uint64_t>::write(out, tag.first);
+                Serializer<uint64_t>::write(out, tag.second);
+            }//for
+        }//for
+    }
+
+    /// Replaces the state of the set with a state written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the state was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        uint64_t replica_id, elements;
+        Context context;
+        if (!Serializer<uint64_t>::read(in, replica_id) or !ReplicaTraits<Replicas>::valid(replica_id) or
+            !context.deserialize(in, Replicas) or !Serializer<uint64_t>::read(in, elements))
+            return false;
+
+        Elements elements_read;
+        for (uint64_t i = 0; i < elements; ++i) {
+            ValueType e;
+            uint64_t tags;
+            if (!Serializer<ValueType>::read(in, e) or !Serializer<uint64_t>::read(in, tags))
+                return false;
+
+            auto& elem = elements_read[e];
+            for (uint64_t j = 0; j < tags; ++j) {
+                uint64_t id;
+                if (!Serializer<uint64_t>::read(in, id) or !ReplicaTraits<Replicas>::valid(id) or
+                    !Serializer<uint64_t>::read(in, elem[id]))
+                    return false;
+            }//for
+        }//for
+
+        this->_replica_id = replica_id;
+        this->_context = context;
+        this->_elements.swap(elements_read);
+        if (!_summary.empty())
+            _rebuild_summary();
+        return true;
+    }
 };
 
 #endif //CRDTS_ORSET_HH
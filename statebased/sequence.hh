@@ -0,0 +1,626 @@
+#ifndef CRDTS_SEQUENCE_HH
+#define CRDTS_SEQUENCE_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../core/instrumentation.hh"
+#include "../core/memory_usage.hh"
+#include "../core/serializer.hh"
+
+/// Sequence implements a replicated ordered list, e.g., the characters of a text, based on the "replicated
+/// growable array" (RGA) [1]. Each item is identified by a dot, i.e., the identifier of the replica that
+/// inserted it and a sequence number drawn from a Lamport clock, and remembers its origin, the item after which
+/// it was inserted. An item is placed after its origin, and concurrent items with the same origin are ordered by
+/// their dots, compared as Timestamp objects are: by sequence number, then by replica identifier. Removed items
+/// remain as tombstones without their values, so that items inserted after them can be placed.
+/// [1] Roh HG, Jeon M, Kim JS, Lee J. (2011). Replicated abstract data types: Building blocks for collaborative
+/// applications. Journal of Parallel and Distributed Computing, 71(3), 354-368.
+///
+/// Consecutive items inserted by a replica, e.g., typed text, are stored as a single block with one dot and one
+/// origin; the dot of the k-th item of a block is the dot of the block plus k, and its origin is the previous
+/// item. Blocks are split when an item is inserted or removed in their middle. Blocks are kept in a treap, a
+/// balanced binary tree, that counts the items and the visible items of each subtree, so the block holding the
+/// item at a position is found in O(log n) for n blocks.
+template<typename ValueType>
+class Sequence {
+private:
+    struct Block {
+        uint64_t replica_id{};        // The replica that inserted the items
+        uint64_t seq_number{};        // The sequence number of the first item
+        uint64_t origin_replica_id{}; // The dot of the origin of the first item, sequence number 0 for
+        uint64_t origin_seq_number{}; // the beginning of the sequence
+        uint64_t length{};
+        bool deleted{};
+        std::vector<ValueType> values; // Empty if the items are deleted
+    };
+
+    struct Node {
+        Block block;
+        uint32_t left{};
+        uint32_t right{};
+        uint32_t parent{};
+        uint32_t priority{};
+        uint64_t items{};   // The number of items in the subtree, including deleted ones
+        uint64_t visible{}; // The number of items in the subtree that are not deleted
+    };
+
+    // Nodes are referred to by their indices, so a sequence can be copied as is; node 0 stands for no node
+    std::vector<Node> _nodes;
+    uint32_t _root{};
+    // The blocks of each replica, ordered by the sequence numbers of their first items
+    std::unordered_map<uint64_t, std::map<uint64_t, uint32_t>> _index;
+    uint64_t _replica_id;
+    uint64_t _clock{}; // The largest sequence number observed
+    uint32_t _random{2463534242};
+
+    /// Checks if dot 1 is greater than dot 2
+    static bool _greater(uint64_t seq_number1, uint64_t replica_id1, uint64_t seq_number2, uint64_t replica_id2) {
+        return seq_number1 > seq_number2 or (seq_number1 == seq_number2 and replica_id1 > replica_id2);
+    }
+
+    uint32_t _priority() {
+        // xorshift32
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        return _random;
+    }
+
+    void _pull(uint32_t i) {
+        auto& node = _nodes[i];
+        node.items = _nodes[node.left].items + node.block.length + _nodes[node.right].items;
+        node.visible = _nodes[node.left].visible + (node.block.deleted ? 0 : node.block.length) +
+                       _nodes[node.right].visible;
+    }
+
+    void _pull_to_root(uint32_t i) {
+        for (; i != 0; i = _nodes[i].parent)
+            _pull(i);
+    }
+
+    /// Rotates a node above its parent
+    void _rotate_up(uint32_t x) {
+        auto p = _nodes[x].parent;
+        auto g = _nodes[p].parent;
+        if (_nodes[p].left == x) {
+            auto b = _nodes[x].right;
+            _nodes[p].left = b;
+            if (b != 0)
+                _nodes[b].parent = p;
+            _nodes[x].right = p;
+        }//if
+        else {
+            auto b = _nodes[x].left;
+            _nodes[p].right = b;
+            if (b != 0)
+                _nodes[b].parent = p;
+            _nodes[x].left = p;
+        }//else
+
+        _nodes[p].parent = x;
+        _nodes[x].parent = g;
+        if (g == 0)
+            _root = x;
+        else if (_nodes[g].left == p)
+            _nodes[g].left = x;
+        else
+            _nodes[g].right = x;
+
+        _pull(p);
+        _pull(x);
+    }
+
+    uint32_t _leftmost(uint32_t i) const {
+        while (_nodes[i].left != 0)
+            i = _nodes[i].left;
+        return i;
+    }
+
+    uint32_t _rightmost(uint32_t i) const {
+        while (_nodes[i].right != 0)
+            i = _nodes[i].right;
+        return i;
+    }
+
+    uint32_t _first() const {
+        return _root == 0 ? 0 : _leftmost(_root);
+    }
+
+    uint32_t _last() const {
+        return _root == 0 ? 0 : _rightmost(_root);
+    }
+
+    /// Gets the next node in the order of the sequence, or 0 after the last node
+    uint32_t _next(uint32_t i) const {
+        if (_nodes[i].right != 0)
+            return _leftmost(_nodes[i].right);
+
+        while (_nodes[i].parent != 0 and _nodes[_nodes[i].parent].right == i)
+            i = _nodes[i].parent;
+        return _nodes[i].parent;
+    }
+
+    /// Gets the previous node in the order of the sequence, or 0 before the first node
+    uint32_t _prev(uint32_t i) const {
+        if (_nodes[i].left != 0)
+            return _rightmost(_nodes[i].left);
+
+        while (_nodes[i].parent != 0 and _nodes[_nodes[i].parent].left == i)
+            i = _nodes[i].parent;
+        return _nodes[i].parent;
+    }
+
+    /// Creates a node for a block that is not linked to the tree yet; references to nodes are invalidated
+    uint32_t _new_node(Block&& block) {
+        auto i = static_cast<uint32_t>(_nodes.size());
+        _index[block.replica_id][block.seq_number] = i;
+        _nodes.emplace_back();
+        _nodes[i].block = std::move(block);
+        _nodes[i].priority = _priority();
+        return i;
+    }
+
+    /// Links a new node right after a given node, or at the beginning if the given node is 0
+    void _link_after(uint32_t prev, uint32_t n) {
+        if (_root == 0) {
+            _root = n;
+            _pull(n);
+            return;
+        }//if
+
+        if (prev != 0 and _nodes[prev].right == 0) {
+            _nodes[prev].right = n;
+            _nodes[n].parent = prev;
+        }//if
+        else {
+            auto parent = _leftmost(prev == 0 ? _root : _nodes[prev].right);
+            _nodes[parent].left = n;
+            _nodes[n].parent = parent;
+        }//else
+
+        _pull_to_root(n);
+        while (_nodes[n].parent != 0 and _nodes[n].priority > _nodes[_nodes[n].parent].priority)
+            _rotate_up(n);
+    }
+
+    /// Splits the block of a node before its k-th item, where 0 < k < length
+    /// \return the node of the items from the k-th item
+    uint32_t _split(uint32_t i, uint64_t k) {
+        Block tail;
+        {
+            auto& block = _nodes[i].block;
+            tail.replica_id = block.replica_id;
+            tail.seq_number = block.seq_number + k;
+            tail.origin_replica_id = block.replica_id;
+            tail.origin_seq_number = block.seq_number + k - 1;
+            tail.length = block.length - k;
+            tail.deleted = block.deleted;
+            if (!block.deleted) {
+                tail.values.assign(std::make_move_iterator(block.values.begin() + k),
+                                   std::make_move_iterator(block.values.end()));
+                block.values.erase(block.values.begin() + k, block.values.end());
+            }//if
+            block.length = k;
+        }
+
+        // The new node is linked below the split node, so the counts of the split node are updated as well
+        auto n = _new_node(std::move(tail));
+        _link_after(i, n);
+        return n;
+    }
+
+    /// Finds the node and offset of an item with a given dot, which must exist
+    std::pair<uint32_t, uint64_t> _locate(uint64_t replica_id, uint64_t seq_number) const {
+        const auto& blocks = _index.at(replica_id);
+        auto block = std::prev(blocks.upper_bound(seq_number));
+        return {block->second, seq_number - block->first};
+    }
+
+    /// Checks if an item with a given dot exists
+    bool _contains(uint64_t replica_id, uint64_t seq_number) const {
+        auto blocks = _index.find(replica_id);
+        if (blocks == _index.end())
+            return false;
+
+        auto block = blocks->second.upper_bound(seq_number);
+        if (block == blocks->second.begin())
+            return false;
+
+        --block;
+        return seq_number - block->first < _nodes[block->second].block.length;
+    }
+
+    /// Finds the node and offset of the visible item at a given position, which must exist
+    std::pair<uint32_t, uint64_t> _find_visible(uint64_t pos) const {
+        auto i = _root;
+        while (true) {
+            const auto& node = _nodes[i];
+            if (pos < _nodes[node.left].visible) {
+                i = node.left;
+                continue;
+            }//if
+
+            pos -= _nodes[node.left].visible;
+            auto own = node.block.deleted ? 0 : node.block.length;
+            if (pos < own)
+                return {i, pos};
+
+            pos -= own;
+            i = node.right;
+        }//while
+    }
+
+    /// Gets the largest sequence number of the items of a given replica
+    /// \return the sequence number, 0 if no item of the replica exists
+    uint64_t _max_seq_number(uint64_t replica_id) const {
+        auto blocks = _index.find(replica_id);
+        if (blocks == _index.end() or blocks->second.empty())
+            return 0;
+
+        const auto& block = _nodes[blocks->second.rbegin()->second].block;
+        return block.seq_number + block.length - 1;
+    }
+
+    void _delete(uint32_t i) {
+        auto& block = _nodes[i].block;
+        block.deleted = true;
+        std::vector<ValueType>().swap(block.values);
+        _pull_to_root(i);
+    }
+
+    /// Deletes a given number of items of a replica starting from a given sequence number
+    void _delete_range(uint64_t replica_id, uint64_t seq_number, uint64_t count) {
+        while (count > 0) {
+            auto item = _locate(replica_id, seq_number);
+            auto node = item.first;
+            auto deleted = std::min(count, _nodes[node].block.length - item.second);
+            if (!_nodes[node].block.deleted) {
+                if (item.second > 0)
+                    node = _split(node, item.second);
+                if (deleted < _nodes[node].block.length)
+                    _split(node, deleted);
+                _delete(node);
+                CRDTS_COUNT(ELEMENTS_ERASED, deleted);
+            }//if
+
+            seq_number += deleted;
+            count -= deleted;
+        }//while
+    }
+
+    /// Places a block of new items after their origin, skipping the items inserted concurrently after the same
+    /// origin that have greater dots, and the items inserted after those
+    void _integrate(Block&& block) {
+        // The new items are placed before the item at the offset of the node, or at the end if the node is 0
+        uint32_t node;
+        uint64_t offset = 0;
+        if (block.origin_seq_number == 0) {
+            node = _first();
+        }//if
+        else {
+            auto origin = _locate(block.origin_replica_id, block.origin_seq_number);
+            node = origin.first;
+            offset = origin.second + 1;
+            if (offset == _nodes[node].block.length) {
+                node = _next(node);
+                offset = 0;
+            }//if
+        }//else
+
+        // The dots of the items of a block increase, so a block is skipped as a whole
+        while (node != 0 and _greater(_nodes[node].block.seq_number + offset, _nodes[node].block.replica_id,
+                                      block.seq_number, block.replica_id)) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            node = _next(node);
+            offset = 0;
+        }//while
+
+        uint32_t prev;
+        if (node == 0) {
+            prev = _last();
+        }//if
+        else if (offset == 0) {
+            prev = _prev(node);
+        }//else if
+        else {
+            _split(node, offset);
+            prev = node;
+        }//else
+
+        // Items that continue the block before them, e.g., typed text, extend that block
+        if (prev != 0) {
+            auto& p = _nodes[prev].block;
+            if (p.replica_id == block.replica_id and p.seq_number + p.length == block.seq_number and
+                block.origin_replica_id == p.replica_id and block.origin_seq_number + 1 == block.seq_number and
+                p.deleted == block.deleted) {
+                p.values.insert(p.values.end(), std::make_move_iterator(block.values.begin()),
+                                std::make_move_iterator(block.values.end()));
+                p.length += block.length;
+                _pull_to_root(prev);
+                return;
+            }//if
+        }//if
+
+        auto n = _new_node(std::move(block));
+        _link_after(prev, n);
+    }
+
+public:
+    /// Creates an empty sequence at a replica identified with a given id
+    /// \param replica_id the given replica id
+    explicit Sequence(uint64_t replica_id) : _nodes(1), _replica_id(replica_id) { }
+
+    /// Inserts a range of values at a given position as a single block
+    /// \param pos the position, at most size()
+    /// \param first the iterator to the first value
+    /// \param last the iterator past the last value
+    template<typename Iterator>
+    void insert(size_t pos, Iterator first, Iterator last) {
+        if (pos > size())
+            throw std::out_of_range("position " + std::to_string(pos) + " exceeds the size of the sequence");
+        if (first == last)
+            return;
+
+        CRDTS_COUNT(OPERATIONS, 1);
+        Block block;
+        block.replica_id = _replica_id;
+        block.seq_number = _clock + 1;
+        block.values.assign(first, last);
+        block.length = block.values.size();
+        if (pos > 0) {
+            auto origin = _find_visible(pos - 1);
+            block.origin_replica_id = _nodes[origin.first].block.replica_id;
+            block.origin_seq_number = _nodes[origin.first].block.seq_number + origin.second;
+        }//if
+
+        _clock += block.length;
+        _integrate(std::move(block));
+    }
+
+    /// Inserts values at a given position
+    /// \param pos the position, at most size()
+    /// \param values the values
+    void insert(size_t pos, const std::vector<ValueType>& values) {
+        insert(pos, values.begin(), values.end());
+    }
+
+    /// Inserts a value at a given position
+    /// \param pos the position, at most size()
+    /// \param value the value
+    void insert(size_t pos, const ValueType& value) {
+        insert(pos, &value, &value + 1);
+    }
+
+    /// Removes a number of values from a given position
+    /// \param pos the position of the first removed value
+    /// \param count the number of removed values; pos + count must be at most size()
+    void erase(size_t pos, size_t count = 1) {
+        if (pos + count > size())
+            throw std::out_of_range("range " + std::to_string(pos) + "+" + std::to_string(count) +
+                                    " exceeds the size of the sequence");
+
+        CRDTS_COUNT(OPERATIONS, 1);
+        while (count > 0) {
+            auto item = _find_visible(pos);
+            auto node = item.first;
+            if (item.second > 0)
+                node = _split(node, item.second);
+            auto deleted = std::min<uint64_t>(count, _nodes[node].block.length);
+            if (deleted < _nodes[node].block.length)
+                _split(node, deleted);
+            _delete(node);
+            count -= deleted;
+        }//while
+    }
+
+    /// Removes all values; their items are kept as tombstones, as in erase
+    void clear() {
+        if (size() > 0)
+            erase(0, size());
+    }
+
+    /// Gets the largest sequence number observed, which the next insert exceeds
+    /// \return the sequence number
+    uint64_t clock() const {
+        return _clock;
+    }
+
+    /// Ensures that later inserts are assigned sequence numbers greater than a given sequence number
+    /// \param seq_number the given sequence number
+    void advance(uint64_t seq_number) {
+        _clock = std::max(_clock, seq_number);
+    }
+
+    /// Gets the value at a given position
+    /// \param pos the position, less than size()
+    /// \return the value
+    const ValueType& at(size_t pos) const {
+        if (pos >= size())
+            throw std::out_of_range("position " + std::to_string(pos) + " exceeds the size of the sequence");
+
+        auto item = _find_visible(pos);
+        return _nodes[item.first].block.values[item.second];
+    }
+
+    /// Gets the values of the sequence in order
+    /// \return the values
+    std::vector<ValueType> values() const {
+        std::vector<ValueType> result;
+        result.reserve(size());
+        for (auto i = _first(); i != 0; i = _next(i))
+            result.insert(result.end(), _nodes[i].block.values.begin(), _nodes[i].block.values.end());
+
+        return result;
+    }
+
+    /// Merges the local sequence with a given remote sequence. Remote blocks are visited in order, so the origin
+    /// of a remote item is placed before the item. The items of a replica known locally are the items with
+    /// sequence numbers up to the largest local one, since a replica that has an item has all earlier items of
+    /// the same replica; remote items are new or merge their removal with local items.
+    /// \param remote the remote sequence
+    void merge(const Sequence<ValueType>& remote) {
+        if (&remote == this)
+            return;
+
+        std::unordered_map<uint64_t, uint64_t> observed;
+        for (const auto& blocks: _index)
+            observed[blocks.first] = _max_seq_number(blocks.first);
+
+        for (auto i = remote._first(); i != 0; i = remote._next(i)) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            const auto& remote_block = remote._nodes[i].block;
+            auto max = observed.find(remote_block.replica_id);
+            auto max_seq_number = max == observed.end() ? 0 : max->second;
+            auto known = remote_block.seq_number > max_seq_number ? 0 :
+                         std::min(remote_block.length, max_seq_number - remote_block.seq_number + 1);
+            if (remote_block.deleted and known > 0)
+                _delete_range(remote_block.replica_id, remote_block.seq_number, known);
+            if (known == remote_block.length)
+                continue;
+
+            Block block;
+            block.replica_id = remote_block.replica_id;
+            block.seq_number = remote_block.seq_number + known;
+            if (known > 0) {
+                block.origin_replica_id = remote_block.replica_id;
+                block.origin_seq_number = remote_block.seq_number + known - 1;
+            }//if
+            else {
+                block.origin_replica_id = remote_block.origin_replica_id;
+                block.origin_seq_number = remote_block.origin_seq_number;
+            }//else
+            block.length = remote_block.length - known;
+            block.deleted = remote_block.deleted;
+            if (!block.deleted)
+                block.values.assign(remote_block.values.begin() + known, remote_block.values.end());
+
+            _integrate(std::move(block));
+            CRDTS_COUNT(ELEMENTS_ADDED, remote_block.length - known);
+        }//for
+
+        _clock = std::max(_clock, remote._clock);
+    }
+
+    /// Gets the number of values
+    /// \return the number of values
+    size_t size() const {
+        return _nodes[_root].visible;
+    }
+
+    /// Gets the number of blocks, including blocks of removed values
+    /// \return the number of blocks
+    size_t blocks() const {
+        return _nodes.size() - 1;
+    }
+
+    /// Gets the local replica id
+    /// \return the local replica id
+    uint64_t replica_id() const {
+        return _replica_id;
+    }
+
+    /// Gets the memory footprint of the sequence: values are values, and the dots, origins, and tree links of
+    /// blocks are metadata; the index of blocks by dots and unused capacity are overhead
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        MemoryUsage usage;
+        usage.metadata = blocks() * (sizeof(Node) - sizeof(std::vector<ValueType>));
+        usage.overhead = (_nodes.capacity() - blocks()) * sizeof(Node) + hash_table_overhead(_index);
+        for (auto i = _first(); i != 0; i = _next(i)) {
+            const auto& values = _nodes[i].block.values;
+            usage.values += sizeof(values) + values.size() * sizeof(ValueType);
+            usage.overhead += (values.capacity() - values.size()) * sizeof(ValueType);
+            for (const auto& value: values)
+                usage.values += HeapSize<ValueType>::of(value);
+        }//for
+
+        for (const auto& blocks: _index)
+            usage.overhead += blocks.second.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + 4 * sizeof(void*));
+
+        return usage;
+    }
+
+    /// Writes the state of the sequence, i.e., its blocks in order, to a stream
+    /// \param out the stream
+    void serialize(std::ostream& out) const {
+        Serializer<uint64_t>::write(out, _replica_id);
+        Serializer<uint64_t>::write(out, _clock);
+        Serializer<uint64_t>::write(out, blocks());
+        for (auto i = _first(); i != 0; i = _next(i)) {
+            const auto& block = _nodes[i].block;
+            Serializer<uint64_t>::write(out, block.replica_id);
+            Serializer<uint64_t>::write(out, block.seq_number);
+            Serializer<uint64_t>::write(out, block.origin_replica_id);
+            Serializer<uint64_t>::write(out, block.origin_seq_number);
+            Serializer<uint64_t>::write(out, block.length);
+            Serializer<bool>::write(out, block.deleted);
+            for (const auto& value: block.values)
+                Serializer<ValueType>::write(out, value);
+        }//for
+    }
+
+    /// Replaces the state of the sequence with a state written by serialize to a stream
+    /// \param in the stream
+    /// \return true if the state was read successfully, otherwise false
+    bool deserialize(std::istream& in) {
+        uint64_t replica_id, clock, blocks;
+        if (!Serializer<uint64_t>::read(in, replica_id) or !Serializer<uint64_t>::read(in, clock) or
+            !Serializer<uint64_t>::read(in, blocks))
+            return false;
+
+        Sequence<ValueType> read(replica_id);
+        read._clock = clock;
+        for (uint64_t b = 0; b < blocks; ++b) {
+            Block block;
+            if (!Serializer<uint64_t>::read(in, block.replica_id) or
+                !Serializer<uint64_t>::read(in, block.seq_number) or
+                !Serializer<uint64_t>::read(in, block.origin_replica_id) or
+                !Serializer<uint64_t>::read(in, block.origin_seq_number) or
+                !Serializer<uint64_t>::read(in, block.length) or !Serializer<bool>::read(in, block.deleted) or
+                block.length == 0 or block.seq_number == 0)
+                return false;
+
+            // The items of a block have sequence numbers up to the clock, do not overlap the items read before,
+            // and follow their origin, which is read before them, so merge and _locate only find existing items
+            auto last_seq_number = block.seq_number + (block.length - 1);
+            if (block.seq_number > clock or block.length - 1 > clock - block.seq_number or
+                read._contains(block.replica_id, block.seq_number) or
+                (block.origin_seq_number != 0 and !read._contains(block.origin_replica_id, block.origin_seq_number)))
+                return false;
+
+            auto blocks_read = read._index.find(block.replica_id);
+            if (blocks_read != read._index.end()) {
+                auto next = blocks_read->second.lower_bound(block.seq_number);
+                if (next != blocks_read->second.end() and next->first <= last_seq_number)
+                    return false;
+            }//if
+
+            // Values are appended as they are read, so a corrupted length fails at the end of the stream rather
+            // than allocating as many values up front
+            for (uint64_t v = 0; !block.deleted and v < block.length; ++v) {
+                ValueType value;
+                if (!Serializer<ValueType>::read(in, value))
+                    return false;
+                block.values.push_back(std::move(value));
+            }//for
+
+            // Blocks are written in order, so each block is linked after the last one
+            auto last = read._last();
+            read._link_after(last, read._new_node(std::move(block)));
+        }//for
+
+        *this = std::move(read);
+        return true;
+    }
+};
+
+#endif //CRDTS_SEQUENCE_HH
@@ -0,0 +1,419 @@
+#ifndef CRDTS_TIERED_HH
+#define CRDTS_TIERED_HH
+
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/serializer.hh"
+#include "../core/segment_store.hh"
+#include "map.hh"
+
+/// TieredMap is a Map whose cold keys are evicted to a segment store on disk (see SegmentStore). The hot keys,
+/// i.e., the keys accessed since the previous eviction, and the causal context stay in memory as a Map. evict
+/// writes the tags and register of each cold key to a new segment, and keeps an index entry that locates them
+/// and holds the timestamp of the register. get, put, and merge fault evicted keys back in when they need their
+/// tags or registers.
+///
+/// A merge faults in a cold key only if the remote tags of the key hold a dot that has not been observed locally,
+/// or the remote register has a greater timestamp; both are decided in memory. Each segment keeps, for every
+/// replica with a tag in the segment, the least sequence number of these tags. A cold key that the remote map
+/// does not hold may have been removed remotely only if the remote map observed its tags, so a segment is skipped
+/// without reading it if, for every replica, the remote map has not observed the least tag of the segment.
+/// Since removes carry no dots, segments the remote map has observed are checked key by key: the index probes
+/// the keys of the remote map in memory, and only keys missing from it are read from disk.
+template<typename KeyType, typename ValueType>
+class TieredMap {
+private:
+    using Tags = typename ReplicaTraits<0>::Tags;
+    using Keys = ORSet<KeyType>;
+
+    // The location of the record of a cold key in the store
+    struct ColdEntry {
+        Timestamp timestamp; // The timestamp of the register, or a zero timestamp if the key has no register
+        uint32_t segment;
+        uint32_t size;
+        uint64_t offset;
+    };
+
+    struct Segment {
+        size_t live{};                                 // The number of cold keys stored in the segment
+        uint64_t bytes{};                              // The size of the records of these keys
+        std::unordered_map<uint64_t, uint64_t> floor;  // The least sequence number of a tag of each replica
+    };
+
+    Map<KeyType, ValueType> _map;
+    std::unordered_map<KeyType, ColdEntry> _cold;
+    std::vector<Segment> _segments;
+    // The hot keys accessed since the previous eviction, the most recently accessed first, and their positions
+    std::list<KeyType> _recent;
+    std::unordered_map<KeyType, typename std::list<KeyType>::iterator> _recent_index;
+    SegmentStore _store;
+    uint64_t _reads{};
+
+    /// Reads the record of a cold key
+    /// \param entry the index entry of the key
+    /// \param tags the tags of the key
+    /// \param reg the register of the key
+    /// \return true if the key has a register, otherwise false
+    bool _read(const ColdEntry& entry, Tags& tags, LWWRegister<ValueType>& reg) {
+        ++_reads;
+        std::istringstream in(_store.read(entry.offset, entry.size));
+        uint64_t count;
+        uint8_t has_register;
+        if (!Serializer<uint64_t>::read(in, count))
+            throw std::runtime_error("corrupted segment record");
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t id;
+            if (!Serializer<uint64_t>::read(in, id) or !Serializer<uint64_t>::read(in, tags[id]))
+                throw std::runtime_error("corrupted segment record");
+        }//for
+        if (!Serializer<uint8_t>::read(in, has_register) or (has_register and !reg.deserialize(in)))
+            throw std::runtime_error("corrupted segment record");
+
+        return has_register;
+    }
+
+    /// Removes a cold key from the index; its record becomes garbage in the store
+    /// \param entry the index entry of the key
+    void _drop(typename std::unordered_map<KeyType, ColdEntry>::iterator entry) {
+        auto& segment = _segments[entry->second.segment];
+        segment.bytes -= entry->second.size;
+        if (--segment.live == 0)
+            segment.floor.clear();
+        _cold.erase(entry);
+    }
+
+    /// Faults a cold key back in to the hot map
+    /// \param key the key
+    void _fault(const KeyType& key) {
+        auto entry = _cold.find(key);
+        if (entry == _cold.end())
+            return;
+
+        Tags tags;
+        LWWRegister<ValueType> reg;
+        auto has_register = _read(entry->second, tags, reg);
+        _map._keys._elements.emplace(key, std::move(tags));
+        _map._keys._summarize(key);
+        if (has_register)
+            _map._registers.emplace(key, std::move(reg));
+        _drop(entry);
+    }
+
+    /// Marks a key as the most recently accessed one
+    /// \param key the key
+    void _touch(const KeyType& key) {
+        auto recent = _recent_index.find(key);
+        if (recent != _recent_index.end()) {
+            _recent.splice(_recent.begin(), _recent, recent->second);
+        }//if
+        else {
+            _recent.push_front(key);
+            _recent_index.emplace(key, _recent.begin());
+        }//else
+    }
+
+    /// Forgets the accesses of a key
+    /// \param key the key
+    void _forget(const KeyType& key) {
+        auto recent = _recent_index.find(key);
+        if (recent != _recent_index.end()) {
+            _recent.erase(recent->second);
+            _recent_index.erase(recent);
+        }//if
+    }
+
+    /// Forgets the accesses of all keys
+    void _forget_all() {
+        _recent.clear();
+        _recent_index.clear();
+    }
+
+    /// Checks if a remote set of keys may have observed a tag of a segment
+    /// \param segment the segment
+    /// \param remote_keys the remote set of keys
+    /// \return false if the remote set has not observed the least tag of the segment of any replica, otherwise true
+    static bool _observed(const Segment& segment, const Keys& remote_keys) {
+        for (const auto& least: segment.floor) {
+            if (remote_keys._context.max(least.first) >= least.second)
+                return true;
+        }//for
+
+        return false;
+    }
+
+    /// Applies remove operations of a remote set of keys to cold keys, see TieredMap
+    /// \param remote_keys the remote set of keys
+    void _apply_cold_removes(const Keys& remote_keys) {
+        std::vector<bool> observed(_segments.size());
+        bool any = false;
+        for (size_t i = 0; i < _segments.size(); ++i) {
+            observed[i] = _segments[i].live > 0 and _observed(_segments[i], remote_keys);
+            any = any or observed[i];
+        }//for
+        if (!any)
+            return;
+
+        for (auto entry = _cold.begin(); entry != _cold.end(); /* no increment here */) {
+            CRDTS_COUNT(ELEMENTS_SCANNED, 1);
+            if (observed[entry->second.segment] and remote_keys._elements.count(entry->first) == 0) {
+                CRDTS_COUNT(HASH_PROBES, 1);
+                Tags tags;
+                LWWRegister<ValueType> reg;
+                _read(entry->second, tags, reg);
+                if (Keys::_removed_remotely(tags, remote_keys)) {
+                    auto removed = entry++;
+                    _drop(removed);
+                    CRDTS_COUNT(ELEMENTS_ERASED, 1);
+                    continue;
+                }//if
+            }//if
+            ++entry;
+        }//for
+    }
+
+    /// Rewrites the records of cold keys when more than half of the store is garbage. The live records are copied
+    /// segment by segment to a new file, which then replaces the store, so only one segment is held in memory.
+    void _compact() {
+        uint64_t live = 0;
+        for (const auto& segment: _segments)
+            live += segment.bytes;
+        if (_store.size() <= 2 * live)
+            return;
+
+        // Records keep their segments, so the least tags of a segment remain valid for its remaining keys;
+        // segments without keys are dropped
+        std::vector<uint32_t> renumbered(_segments.size());
+        uint32_t kept = 0;
+        for (size_t i = 0; i < _segments.size(); ++i) {
+            if (_segments[i].live > 0)
+                renumbered[i] = kept++;
+        }//for
+
+        std::vector<std::vector<ColdEntry*>> records(kept);
+        for (auto& entry: _cold)
+            records[renumbered[entry.second.segment]].push_back(&entry.second);
+
+        // The index is updated once the new file has replaced the store, so a failure leaves it valid
+        SegmentStore compacted(_store.path() + ".compact");
+        std::vector<uint64_t> offsets;
+        offsets.reserve(_cold.size());
+        for (const auto& segment: records) {
+            std::string content;
+            for (const auto* entry: segment) {
+                offsets.push_back(compacted.size() + content.size());
+                content += _store.read(entry->offset, entry->size);
+            }//for
+            compacted.append(content);
+        }//for
+
+        _store.replace(compacted);
+        auto offset = offsets.begin();
+        for (size_t i = 0; i < records.size(); ++i) {
+            for (auto* entry: records[i]) {
+                entry->segment = i;
+                entry->offset = *offset++;
+            }//for
+        }//for
+
+        std::vector<Segment> segments;
+        segments.reserve(kept);
+        for (auto& segment: _segments) {
+            if (segment.live > 0)
+                segments.push_back(std::move(segment));
+        }//for
+        _segments.swap(segments);
+    }
+
+public:
+    /// Creates a tiered map whose cold keys are stored at a given path
+    /// \param replica_id the given replica id
+    /// \param path the path of the segment store, which is truncated and removed with the map
+    TieredMap(uint64_t replica_id, const std::string& path) : _map(replica_id), _store(path) { }
+
+    /// Puts a given key and value pair to the map
+    /// \param key the given key
+    /// \param val the given value
+    void put(const KeyType& key, const ValueType& val) {
+        _fault(key);
+        _map.put(key, val);
+        _touch(key);
+    }
+
+    /// Gets the value of a given key, faulting it in if it is cold
+    /// \param key the given key
+    /// \return the value
+    ValueType get(const KeyType& key) {
+        _fault(key);
+        _touch(key);
+        return _map.get(key);
+    }
+
+    /// Removes a given key from the map
+    /// \param key the given key
+    void remove(const KeyType& key) {
+        auto entry = _cold.find(key);
+        if (entry != _cold.end())
+            _drop(entry);
+        _map.remove(key);
+        _forget(key);
+    }
+
+    /// Checks the existence of a given key without faulting it in
+    /// \param key the given key
+    /// \return true if the key exists, otherwise false
+    bool contains(const KeyType& key) const {
+        return _map.contains(key) or _cold.count(key) > 0;
+    }
+
+    /// Merges a given map with the local map
+    /// \param map the given map
+    void merge(const Map<KeyType, ValueType>& map) {
+        const auto& remote_keys = map._keys;
+        if (!_cold.empty()) {
+            // Fault in cold keys with remote adds that have not been observed locally or newer remote registers
+            for (const auto& remote_key: remote_keys._elements) {
+                CRDTS_COUNT(HASH_PROBES, 1);
+                auto entry = _cold.find(remote_key.first);
+                if (entry == _cold.end())
+                    continue;
+
+                auto fault = Keys::_added_remotely(remote_key.second, _map._keys._context);
+                if (!fault) {
+                    auto remote_reg = map._registers.find(remote_key.first);
+                    fault = remote_reg != map._registers.end() and
+                            entry->second.timestamp < remote_reg->second._timestamp;
+                }//if
+                if (fault)
+                    _fault(remote_key.first);
+            }//for
+        }//if
+
+        _apply_cold_removes(remote_keys);
+        _map.merge(map);
+    }
+
+    /// Evicts keys that have not been accessed since the previous eviction, or the least recently accessed keys
+    /// otherwise, until at most a given number of keys is hot. The evicted keys are written to a new segment.
+    /// \param hot_keys the number of keys that remain hot
+    void evict(size_t hot_keys) {
+        auto& elements = _map._keys._elements;
+        if (elements.size() <= hot_keys) {
+            _forget_all();
+            return;
+        }//if
+
+        std::vector<KeyType> victims;
+        auto count = elements.size() - hot_keys;
+        for (const auto& elem: elements) {
+            if (victims.size() < count and _recent_index.count(elem.first) == 0)
+                victims.push_back(elem.first);
+        }//for
+        for (auto recent = _recent.rbegin(); victims.size() < count and recent != _recent.rend(); ++recent) {
+            // A key accessed before may have been removed by a merge since
+            if (elements.count(*recent) > 0)
+                victims.push_back(*recent);
+        }//for
+
+        Segment segment;
+        std::ostringstream out;
+        std::vector<ColdEntry> entries;
+        for (const auto& key: victims) {
+            auto elem = elements.find(key);
+            auto begin = static_cast<uint64_t>(out.tellp());
+            Serializer<uint64_t>::write(out, elem->second.size());
+            for (const auto& tag: elem->second) {
+                Serializer<uint64_t>::write(out, tag.first);
+                Serializer<uint64_t>::write(out, tag.second);
+                auto least = segment.floor.emplace(tag.first, tag.second);
+                if (!least.second and tag.second < least.first->second)
+                    least.first->second = tag.second;
+            }//for
+
+            Timestamp timestamp;
+            auto reg = _map._registers.find(key);
+            Serializer<uint8_t>::write(out, reg != _map._registers.end());
+            if (reg != _map._registers.end()) {
+                timestamp = reg->second._timestamp;
+                reg->second.serialize(out);
+                _map._registers.erase(reg);
+            }//if
+            elements.erase(elem);
+
+            auto size = static_cast<uint32_t>(static_cast<uint64_t>(out.tellp()) - begin);
+            entries.push_back(ColdEntry{timestamp, static_cast<uint32_t>(_segments.size()), size, begin});
+            segment.bytes += size;
+        }//for
+
+        auto offset = _store.append(out.str());
+        for (size_t i = 0; i < victims.size(); ++i) {
+            entries[i].offset += offset;
+            _cold[victims[i]] = entries[i];
+        }//for
+        segment.live = victims.size();
+        _segments.push_back(std::move(segment));
+        _forget_all();
+        _compact();
+    }
+
+    /// Gets the number of keys in the map, including cold keys
+    /// \return the number of keys
+    size_t size() {
+        return _map.size() + _cold.size();
+    }
+
+    /// Gets the number of cold keys
+    /// \return the number of cold keys
+    size_t cold_size() const {
+        return _cold.size();
+    }
+
+    /// Gets the number of records read from the store, e.g., to check that merges skip segments
+    /// \return the number of records read
+    uint64_t reads() const {
+        return _reads;
+    }
+
+    /// Gets the whole state of the map, including cold keys, e.g., to send it to other replicas. Cold keys are
+    /// read from the store, but not faulted in.
+    /// \return the map
+    Map<KeyType, ValueType> state() {
+        auto result = _map;
+        for (const auto& entry: _cold) {
+            Tags tags;
+            LWWRegister<ValueType> reg;
+            if (_read(entry.second, tags, reg))
+                result._registers.emplace(entry.first, std::move(reg));
+            result._keys._elements.emplace(entry.first, std::move(tags));
+            result._keys._summarize(entry.first);
+        }//for
+
+        return result;
+    }
+
+    /// Gets the memory footprint of the map in memory: the hot map, the index of cold keys, whose entries are
+    /// metadata, the least tags of segments, and the order of accesses to hot keys, which is overhead
+    /// \return the memory usage
+    MemoryUsage memory_usage() const {
+        auto usage = _map.memory_usage();
+        usage.overhead += hash_table_overhead(_cold);
+        for (const auto& entry: _cold) {
+            usage.keys += footprint(entry.first);
+            usage.metadata += sizeof(ColdEntry);
+        }//for
+        for (const auto& segment: _segments) {
+            usage.metadata += sizeof(Segment) + segment.floor.size() * sizeof(std::pair<const uint64_t, uint64_t>);
+            usage.overhead += hash_table_overhead(segment.floor);
+        }//for
+        usage.overhead += hash_table_overhead(_recent_index);
+        for (const auto& key: _recent)
+            usage.overhead += 2 * footprint(key) + 2 * sizeof(void*);
+
+        return usage;
+    }
+};
+
+#endif //CRDTS_TIERED_HH
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include <sstream>
+#include <string>
+#include "../core/bloom_filter.hh"
+
+namespace {
+    #define FILTER_TEST_CASES 10000
+
+    uint64_t hash(int i) {
+        return std::hash<std::string>()(std::to_string(i));
+    }
+
+    TEST(BloomFilter, InsertAndQuery) {
+        // An empty filter contains every hash code
+        BloomFilter empty;
+        EXPECT_TRUE(empty.empty());
+        EXPECT_TRUE(empty.may_contain(hash(0)));
+        empty.insert(hash(0));
+        EXPECT_EQ(0, empty.inserted());
+
+        // A filter has no false negatives, and about 1% of false positives for 10 bits per hash code
+        BloomFilter filter(FILTER_TEST_CASES);
+        for (int i = 0; i < FILTER_TEST_CASES; ++i)
+            filter.insert(hash(i));
+        for (int i = 0; i < FILTER_TEST_CASES; ++i)
+            EXPECT_TRUE(filter.may_contain(hash(i)));
+
+        int false_positives = 0;
+        for (int i = FILTER_TEST_CASES; i < 2 * FILTER_TEST_CASES; ++i)
+            false_positives += filter.may_contain(hash(i));
+        EXPECT_GT(FILTER_TEST_CASES / 50, false_positives);
+        EXPECT_FALSE(filter.full());
+        filter.insert(hash(FILTER_TEST_CASES));
+        EXPECT_TRUE(filter.full());
+        EXPECT_EQ((FILTER_TEST_CASES * 10 + 63) / 64 * sizeof(uint64_t), filter.memory_usage().metadata);
+    }//TEST
+
+    TEST(BloomFilter, Serialize) {
+        BloomFilter filter(FILTER_TEST_CASES, 16), read;
+        for (int i = 0; i < FILTER_TEST_CASES; i += 2)
+            filter.insert(hash(i));
+
+        std::stringstream stream;
+        filter.serialize(stream);
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_EQ(filter.capacity(), read.capacity());
+        EXPECT_EQ(filter.inserted(), read.inserted());
+        EXPECT_EQ(16, read.bits_per_hash());
+        for (int i = 0; i < FILTER_TEST_CASES; ++i)
+            EXPECT_EQ(filter.may_contain(hash(i)), read.may_contain(hash(i)));
+
+        std::stringstream truncated(stream.str().substr(0, 10));
+        EXPECT_FALSE(read.deserialize(truncated));
+    }//TEST
+}//namespace
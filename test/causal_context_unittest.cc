@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <sstream>
+#include "../core/causal_context.hh"
+
+namespace {
+    #define CONTEXT_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    TEST(CausalContext, Compaction) {
+        CausalContext context;
+        context.add(REPLICA1_ID, 1);
+        context.add(REPLICA1_ID, 3);
+        context.add(REPLICA1_ID, 4);
+        EXPECT_EQ(2, context.exceptions());
+        EXPECT_FALSE(context.contains(REPLICA1_ID, 2));
+
+        context.add(REPLICA1_ID, 2);
+        EXPECT_EQ(0, context.exceptions());
+        EXPECT_EQ(4, context.max(REPLICA1_ID));
+    }//TEST
+
+    TEST(CausalContext, AddAndContains) {
+        CausalContext context;
+        // Use a C++ set of dots as a reference for testing
+        std::set<std::pair<uint64_t, uint64_t>> ref;
+        for (int i = 0; i < CONTEXT_TEST_CASES; ++i) {
+            auto id = random() % 2 + REPLICA1_ID;
+            auto seq = random() % (CONTEXT_TEST_CASES / 2) + 1;
+            context.add(id, seq);
+            ref.emplace(id, seq);
+        }//for
+
+        for (uint64_t id = REPLICA1_ID; id <= REPLICA2_ID; ++id) {
+            for (uint64_t seq = 1; seq <= CONTEXT_TEST_CASES / 2; ++seq)
+                EXPECT_EQ(ref.count(std::make_pair(id, seq)) == 1, context.contains(id, seq));
+        }//for
+        EXPECT_LE(context.exceptions(), ref.size());
+
+        // Filling the gaps compacts all exceptions into prefixes
+        for (uint64_t id = REPLICA1_ID; id <= REPLICA2_ID; ++id) {
+            for (uint64_t seq = 1; seq <= CONTEXT_TEST_CASES / 2; ++seq)
+                context.add(id, seq);
+        }//for
+        EXPECT_EQ(0, context.exceptions());
+    }//TEST
+
+    TEST(CausalContext, JoinAndIncludes) {
+        CausalContext c1, c2;
+        for (int i = 0; i < CONTEXT_TEST_CASES; ++i) {
+            auto& c = (random() % 2 == 0) ? c1 : c2;
+            c.add(random() % 2 + REPLICA1_ID, random() % CONTEXT_TEST_CASES + 1);
+        }//for
+
+        auto joined = c1;
+        joined.join(c2);
+        EXPECT_TRUE(joined.includes(c1));
+        EXPECT_TRUE(joined.includes(c2));
+        for (uint64_t id = REPLICA1_ID; id <= REPLICA2_ID; ++id) {
+            for (uint64_t seq = 1; seq <= CONTEXT_TEST_CASES; ++seq)
+                EXPECT_EQ(c1.contains(id, seq) or c2.contains(id, seq), joined.contains(id, seq));
+        }//for
+
+        // Join is commutative and idempotent
+        auto reversed = c2;
+        reversed.join(c1);
+        EXPECT_TRUE(joined == reversed);
+        reversed.join(c1);
+        EXPECT_TRUE(joined == reversed);
+
+        c1.add(REPLICA2_ID, 2 * CONTEXT_TEST_CASES);
+        EXPECT_FALSE(joined.includes(c1));
+    }//TEST
+
+    TEST(CausalContext, Serialize) {
+        CausalContext context;
+        for (int i = 0; i < CONTEXT_TEST_CASES; ++i)
+            context.add(random() % 2 + REPLICA1_ID, random() % CONTEXT_TEST_CASES + 1);
+
+        std::stringstream stream;
+        context.serialize(stream);
+        CausalContext read;
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_TRUE(context == read);
+
+        // A corrupted count of exceptions fails at the end of the stream instead of allocating the whole count
+        std::stringstream corrupted;
+        for (uint64_t field: {1, REPLICA1_ID, 0})
+            Serializer<uint64_t>::write(corrupted, field);
+        Serializer<uint64_t>::write(corrupted, UINT64_MAX / 2);
+        Serializer<uint64_t>::write(corrupted, 2);
+        EXPECT_FALSE(read.deserialize(corrupted));
+        EXPECT_TRUE(context == read);
+    }//TEST
+
+    TEST(CausalContext, Fixed) {
+        #define FIXED_REPLICAS 3
+        // A fixed context contains the same dots as a context for any number of replicas
+        CausalContext dynamic;
+        FixedCausalContext<FIXED_REPLICAS> fixed, other;
+        for (int i = 0; i < CONTEXT_TEST_CASES; ++i) {
+            auto id = random() % FIXED_REPLICAS;
+            auto seq = random() % CONTEXT_TEST_CASES + 1;
+            dynamic.add(id, seq);
+            fixed.add(id, seq);
+            if (i % 2 == 0)
+                other.add(id, seq);
+        }//for
+
+        EXPECT_EQ(dynamic.exceptions(), fixed.exceptions());
+        for (uint64_t id = 0; id < FIXED_REPLICAS; ++id) {
+            EXPECT_EQ(dynamic.max(id), fixed.max(id));
+            for (uint64_t seq = 1; seq <= CONTEXT_TEST_CASES; ++seq)
+                EXPECT_EQ(dynamic.contains(id, seq), fixed.contains(id, seq));
+        }//for
+        EXPECT_FALSE(fixed.contains(FIXED_REPLICAS, 1));
+        EXPECT_TRUE(fixed.includes(other));
+        EXPECT_EQ(0, fixed.memory_usage().overhead);
+
+        std::stringstream stream;
+        fixed.serialize(stream);
+        FixedCausalContext<FIXED_REPLICAS> read;
+        EXPECT_TRUE(read.deserialize(stream, FIXED_REPLICAS));
+        EXPECT_TRUE(fixed == read);
+
+        // A context with replica ids that a fixed context cannot store is rejected
+        std::stringstream dynamic_stream;
+        dynamic.add(FIXED_REPLICAS, 1);
+        dynamic.serialize(dynamic_stream);
+        EXPECT_FALSE(read.deserialize(dynamic_stream, FIXED_REPLICAS));
+    }//TEST
+}//namespace
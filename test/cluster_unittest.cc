@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include "../sim/cluster.hh"
+
+namespace {
+    #define CLUSTER_REPLICAS 5
+
+    ClusterConfig lossy_config() {
+        ClusterConfig config;
+        config.replicas = CLUSTER_REPLICAS;
+        config.workload.write_rate = 0.5;
+        config.workload.write_ticks = 50;
+        config.workload.keys = 100;
+        config.workload.skew = 1;
+        config.workload.remove_ratio = 0.2;
+        config.network.loss = 0.2;
+        config.network.min_delay = 1;
+        config.network.max_delay = 3;
+        return config;
+    }
+
+    TEST(Cluster, Converges) {
+        auto config = lossy_config();
+        Cluster<ORSet<std::string>> sets(config, std::unique_ptr<Topology>(new RandomPeers(2)));
+        auto report = sets.run();
+        EXPECT_TRUE(report.converged);
+        EXPECT_GT(report.lost_messages, 0);
+        EXPECT_GT(report.bytes, 0);
+        EXPECT_EQ(CLUSTER_REPLICAS, report.memory.size());
+        EXPECT_EQ(CLUSTER_REPLICAS, report.merge_time.size());
+        for (size_t r = 1; r < CLUSTER_REPLICAS; ++r)
+            EXPECT_TRUE(sets.replica(0).elements() == sets.replica(r).elements());
+
+        config.mode = SyncMode::PUSH_PULL;
+        Cluster<Map<std::string, uint64_t>> maps(config, std::unique_ptr<Topology>(new Ring()));
+        EXPECT_TRUE(maps.run().converged);
+
+        Cluster<LWWRegister<uint64_t>> registers(config, std::unique_ptr<Topology>(new FullMesh()));
+        EXPECT_TRUE(registers.run().converged);
+    }//TEST
+
+    TEST(Cluster, Deterministic) {
+        auto config = lossy_config();
+        config.seed = random();
+        Cluster<Map<std::string, uint64_t>> cluster1(config, std::unique_ptr<Topology>(new RandomPeers(1)));
+        Cluster<Map<std::string, uint64_t>> cluster2(config, std::unique_ptr<Topology>(new RandomPeers(1)));
+        auto report1 = cluster1.run();
+        auto report2 = cluster2.run();
+        EXPECT_EQ(report1.convergence_ticks, report2.convergence_ticks);
+        EXPECT_EQ(report1.operations, report2.operations);
+        EXPECT_EQ(report1.messages, report2.messages);
+        EXPECT_EQ(report1.lost_messages, report2.lost_messages);
+        EXPECT_EQ(report1.bytes, report2.bytes);
+        EXPECT_TRUE(cluster1.replica(0).key_value_pairs() == cluster2.replica(0).key_value_pairs());
+    }//TEST
+}//namespace
@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include "../statebased/durable.hh"
+
+namespace {
+    #define DURABLE_TEST_CASES 1000
+
+    class TempDirectory {
+    private:
+        std::string _path;
+
+    public:
+        TempDirectory() {
+            char dir[] = "/tmp/crdts_durable_XXXXXX";
+            EXPECT_NE(nullptr, mkdtemp(dir));
+            _path = dir;
+        }
+
+        ~TempDirectory() {
+            std::filesystem::remove_all(_path);
+        }
+
+        /// Gets the path prefix of the logs and checkpoint of a durable CRDT in the directory
+        std::string state() const {
+            return _path + "/state";
+        }
+    };
+
+    TEST(WriteAheadLog, AppendAndReplay) {
+        TempDirectory dir;
+        auto path = dir.state() + ".wal";
+        WALOptions options;
+        options.group_size = 8;
+
+        std::vector<std::string> ref;
+        {
+            WriteAheadLog wal(path, options);
+            for (int i = 0; i < DURABLE_TEST_CASES; ++i) {
+                ref.push_back(std::to_string(random()));
+                EXPECT_EQ(i + 1, wal.append(ref.back()));
+            }//for
+        }
+
+        // Reopening the log continues the LSNs and replays records in order
+        WriteAheadLog wal(path, options);
+        EXPECT_EQ(ref.size(), wal.last_lsn());
+
+        std::vector<std::string> replayed;
+        wal.replay([&](uint64_t lsn, const std::string& payload) {
+            EXPECT_EQ(replayed.size() + 1, lsn);
+            replayed.push_back(payload);
+        });
+        EXPECT_TRUE(ref == replayed);
+    }//TEST
+
+    TEST(WriteAheadLog, TornTail) {
+        TempDirectory dir;
+        auto path = dir.state() + ".wal";
+        {
+            WriteAheadLog wal(path, WALOptions());
+            wal.append("first");
+            wal.append("second");
+        }
+
+        // Simulate a crash in the middle of writing a record
+        {
+            std::ofstream out(path, std::ios::app | std::ios::binary);
+            out << "torn";
+        }
+
+        WriteAheadLog wal(path, WALOptions());
+        EXPECT_EQ(2, wal.last_lsn());
+        wal.append("third");
+        wal.commit();
+
+        std::vector<std::string> replayed;
+        wal.replay([&](uint64_t, const std::string& payload) { replayed.push_back(payload); });
+        EXPECT_TRUE((std::vector<std::string>{"first", "second", "third"}) == replayed);
+    }//TEST
+
+    TEST(WriteAheadLog, Reset) {
+        TempDirectory dir;
+        auto path = dir.state() + ".wal";
+        {
+            WriteAheadLog wal(path, WALOptions());
+            for (int i = 0; i < DURABLE_TEST_CASES; ++i)
+                wal.append(std::to_string(i));
+            wal.commit();
+
+            // Records appended after a reset overwrite the discarded ones, which are skipped on replay
+            wal.reset();
+            wal.append("first");
+            wal.append("second");
+        }
+
+        WriteAheadLog wal(path, WALOptions());
+        EXPECT_EQ(DURABLE_TEST_CASES + 2, wal.last_lsn());
+
+        std::vector<std::string> replayed;
+        wal.replay([&](uint64_t, const std::string& payload) { replayed.push_back(payload); });
+        EXPECT_TRUE((std::vector<std::string>{"first", "second"}) == replayed);
+    }//TEST
+
+    TEST(Serializer, CorruptedLength) {
+        // A corrupted length fails at the end of the stream instead of allocating the whole length
+        std::stringstream stream;
+        Serializer<uint64_t>::write(stream, UINT64_MAX / 2);
+        stream.write("abc", 3);
+        std::string val;
+        EXPECT_FALSE(Serializer<std::string>::read(stream, val));
+
+        std::stringstream valid;
+        Serializer<std::string>::write(valid, std::string(100000, 'x'));
+        ASSERT_TRUE(Serializer<std::string>::read(valid, val));
+        EXPECT_EQ(std::string(100000, 'x'), val);
+    }//TEST
+
+    TEST(DurableORSet, Recover) {
+        #define REPLICA_ID 1
+        TempDirectory dir;
+        auto path = dir.state();
+        WALOptions options;
+        options.group_size = 16;
+        options.checkpoint_interval = DURABLE_TEST_CASES / 3;
+
+        std::unordered_set<std::string> ref;
+        std::vector<std::string> keys;
+        {
+            DurableORSet<std::string> set(REPLICA_ID, path, options);
+            for (int i = 0; i < DURABLE_TEST_CASES; ++i) {
+                auto b = std::to_string(random() % DURABLE_TEST_CASES);
+                if (random() % 4 == 0 and !keys.empty()) {
+                    auto rand_ind = random() % keys.size();
+                    set.remove(keys[rand_ind]);
+                    ref.erase(keys[rand_ind]);
+                    std::swap(keys[rand_ind], keys[keys.size() - 1]);
+                    keys.pop_back();
+                }//if
+                else {
+                    set.add(b);
+                    if (ref.insert(b).second)
+                        keys.push_back(b);
+                }//else
+            }//for
+            set.sync();
+        }
+
+        DurableORSet<std::string> set(REPLICA_ID, path, options);
+        EXPECT_TRUE(ref == set.state().elements());
+
+        // The recovered set continues tagging with newer timestamps, so it merges correctly with others
+        #define REPLICA2_ID 2
+        ORSet<std::string> other(REPLICA2_ID);
+        other.merge(set.state());
+        for (const auto& e: ref)
+            other.remove(e);
+        set.add("new");
+        set.merge(other);
+        EXPECT_TRUE(set.contains("new"));
+        EXPECT_EQ(1, set.state().elements().size());
+    }//TEST
+
+    TEST(DurableMap, Recover) {
+        TempDirectory dir;
+        auto path = dir.state();
+        WALOptions options;
+        options.checkpoint_interval = DURABLE_TEST_CASES / 3;
+
+        std::unordered_map<std::string, std::string> ref;
+        {
+            DurableMap<std::string, std::string> map(REPLICA_ID, path, options);
+            for (int i = 0; i < DURABLE_TEST_CASES; ++i) {
+                auto k = std::to_string(random() % DURABLE_TEST_CASES);
+                if (random() % 4 == 0) {
+                    map.remove(k);
+                    ref.erase(k);
+                }//if
+                else {
+                    auto v = std::to_string(random());
+                    map.put(k, v);
+                    ref[k] = v;
+                }//else
+            }//for
+
+            // Merged pairs are durable after a checkpoint
+            Map<std::string, std::string> other(REPLICA2_ID);
+            other.put("remote", "value");
+            map.merge(other);
+            ref["remote"] = "value";
+            map.checkpoint();
+
+            map.put("after", "checkpoint");
+            ref["after"] = "checkpoint";
+        }
+
+        DurableMap<std::string, std::string> map(REPLICA_ID, path, options);
+        auto state = map.state();
+        EXPECT_TRUE(ref == state.key_value_pairs());
+
+        // Timestamps of registers are restored, so later puts win over recovered values
+        map.put("after", "recovery");
+        EXPECT_EQ("recovery", map.get("after"));
+    }//TEST
+
+    TEST(DurableMap, IncrementalCheckpoints) {
+        #define CHECKPOINT_INTERVAL 16
+        TempDirectory dir;
+        auto path = dir.state();
+        WALOptions options;
+        options.group_size = 4;
+        options.checkpoint_interval = CHECKPOINT_INTERVAL;
+
+        // Few keys, so keys are removed and put again within and across checkpoints
+        std::unordered_map<std::string, std::string> ref;
+        for (int round = 0; round < 3; ++round) {
+            {
+                DurableMap<std::string, std::string> map(REPLICA_ID, path, options);
+                auto state = map.state();
+                EXPECT_TRUE(ref == state.key_value_pairs());
+                for (int i = 0; i < DURABLE_TEST_CASES; ++i) {
+                    auto k = std::to_string(random() % 32);
+                    if (random() % 3 == 0) {
+                        map.remove(k);
+                        ref.erase(k);
+                    }//if
+                    else {
+                        auto v = std::to_string(random());
+                        map.put(k, v);
+                        ref[k] = v;
+                    }//else
+                }//for
+                map.sync();
+            }
+
+            // The log of the recovered map holds fewer records than the interval, the rest are in deltas
+            size_t records = 0;
+            WriteAheadLog(path + ".wal", options).replay([&](uint64_t, const std::string&) { ++records; });
+            EXPECT_GT(CHECKPOINT_INTERVAL, records);
+            EXPECT_LT(0, std::filesystem::file_size(path + ".deltas"));
+        }//for
+
+        DurableMap<std::string, std::string> map(REPLICA_ID, path, options);
+        auto state = map.state();
+        EXPECT_TRUE(ref == state.key_value_pairs());
+
+        // Recovered tags and timestamps are the latest ones, so a remote map that saw the recovered puts and
+        // removes all keys leaves no key behind
+        Map<std::string, std::string> other(REPLICA2_ID);
+        other.merge(map.state());
+        for (const auto& pair: ref)
+            other.remove(pair.first);
+        map.merge(other);
+        state = map.state();
+        EXPECT_EQ(0, state.key_value_pairs().size());
+    }//TEST
+}//namespace
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "../core/containers.hh"
+
+namespace {
+    #define TABLE_TEST_CASES 10000
+
+    TEST(FlatHashMap, InsertFindErase) {
+        FlatHashMap<uint64_t, uint64_t> table;
+        // Use a C++ unordered map as a reference for testing
+        std::unordered_map<uint64_t, uint64_t> ref;
+        for (int i = 0; i < TABLE_TEST_CASES; ++i) {
+            auto key = random() % (TABLE_TEST_CASES / 4);
+            if (random() % 3 == 0) {
+                EXPECT_EQ(ref.erase(key), table.erase(key));
+            }//if
+            else {
+                table[key] = i;
+                ref[key] = i;
+            }//else
+        }//for
+
+        EXPECT_EQ(ref.size(), table.size());
+        for (const auto& kv: ref) {
+            auto entry = table.find(kv.first);
+            ASSERT_TRUE(entry != table.end());
+            EXPECT_EQ(kv.second, entry->second);
+        }//for
+
+        size_t visited = 0;
+        for (const auto& kv: table) {
+            EXPECT_EQ(ref[kv.first], kv.second);
+            ++visited;
+        }//for
+        EXPECT_EQ(ref.size(), visited);
+
+        for (auto entry = table.begin(); entry != table.end(); /* no increment here */) {
+            if (entry->first % 2 == 0)
+                entry = table.erase(entry);
+            else
+                ++entry;
+        }//for
+        for (const auto& kv: ref)
+            EXPECT_EQ(kv.first % 2, table.count(kv.first));
+    }//TEST
+
+    TEST(FlatHashMap, ReclaimDeletedSlots) {
+        FlatHashMap<uint64_t, uint64_t> table;
+        table.reserve(64);
+        auto capacity = table.bucket_count();
+        // Churning a small number of keys must not grow the table
+        for (uint64_t i = 0; i < TABLE_TEST_CASES; ++i) {
+            table[i] = i;
+            if (i >= 8)
+                table.erase(i - 8);
+        }//for
+
+        EXPECT_EQ(8, table.size());
+        EXPECT_EQ(capacity, table.bucket_count());
+        EXPECT_LT(0, table.rehashes());
+        for (uint64_t i = TABLE_TEST_CASES - 8; i < TABLE_TEST_CASES; ++i)
+            EXPECT_EQ(1, table.count(i));
+    }//TEST
+
+    TEST(FlatHashMap, StringViewLookup) {
+        FlatHashMap<std::string, int> table;
+        for (int i = 0; i < TABLE_TEST_CASES / 10; ++i)
+            table["key" + std::to_string(i)] = i;
+
+        std::string text = "a key17 in a sentence";
+        EXPECT_EQ(1, table.count(std::string_view(text).substr(2, 5)));
+        EXPECT_EQ(17, table.find(std::string_view("key17"))->second);
+        EXPECT_TRUE(table.find(std::string_view("key")) == table.end());
+
+        // C strings are hashed by their characters, not by their addresses
+        const char* c_string = "key17";
+        EXPECT_EQ(1, table.count(c_string));
+        EXPECT_EQ(1, table.count("key17"));
+        EXPECT_EQ(0, table.count("key"));
+
+        std::vector<std::string_view> keys = {"key1", "none", "key999"};
+        std::vector<int> found(keys.size(), -1);
+        find_many(table, keys.size(), [&keys](size_t i) { return keys[i]; },
+                  [&table, &found](size_t i, FlatHashMap<std::string, int>::const_iterator entry) {
+                      if (entry != table.end())
+                          found[i] = entry->second;
+                  });
+        EXPECT_EQ(std::vector<int>({1, -1, 999}), found);
+    }//TEST
+
+    TEST(FlatHashMap, CopyAndExtract) {
+        FlatHashMap<std::string, std::string> table1;
+        for (int i = 0; i < TABLE_TEST_CASES / 10; ++i)
+            table1[std::to_string(i)] = std::string(32, 'a' + i % 26);
+        for (int i = 0; i < TABLE_TEST_CASES / 10; i += 3)
+            table1.erase(std::to_string(i));
+
+        auto table2 = table1;
+        EXPECT_EQ(table1.size(), table2.size());
+        for (const auto& kv: table1)
+            EXPECT_EQ(kv.second, table2.find(kv.first)->second);
+
+        FlatHashMap<std::string, std::string> table3;
+        for (auto entry = table2.begin(); entry != table2.end(); /* no increment here */)
+            table3.insert(table2.extract(entry++));
+        EXPECT_EQ(0, table2.size());
+        EXPECT_EQ(table1.size(), table3.size());
+        for (const auto& kv: table1)
+            EXPECT_EQ(kv.second, table3.find(kv.first)->second);
+    }//TEST
+}//namespace
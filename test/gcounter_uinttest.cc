@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "../statebased/gcounter.hh"
+
+namespace {
+    #define COUNTER_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    TEST(GCounter, IncrementAndMerge) {
+        GCounter<uint64_t> cnt1, cnt2;
+        cnt1.replica_id(REPLICA1_ID);
+        cnt2.replica_id(REPLICA2_ID);
+
+        auto increments1 = random() % COUNTER_TEST_CASES + 1;
+        auto increments2 = random() % COUNTER_TEST_CASES + 1;
+        for (auto i = 0; i < increments1; ++i)
+            cnt1.increment();
+        for (auto i = 0; i < increments2; ++i)
+            cnt2.increment();
+        EXPECT_EQ(increments1, cnt1.value());
+
+        cnt1.merge(cnt2);
+        cnt2.merge(cnt1);
+        cnt1.merge(cnt2);
+        EXPECT_EQ(increments1 + increments2, cnt1.value());
+        EXPECT_EQ(cnt1.value(), cnt2.value());
+    }//TEST
+
+    TEST(GCounter, MemoryUsage) {
+        GCounter<uint32_t> cnt1, cnt2;
+        cnt1.replica_id(REPLICA1_ID);
+        cnt2.replica_id(REPLICA2_ID);
+        cnt1.increment();
+        cnt2.increment();
+        cnt1.merge(cnt2);
+
+        auto usage = cnt1.memory_usage();
+        EXPECT_EQ(0, usage.keys);
+        EXPECT_EQ(2 * sizeof(uint32_t), usage.values);
+        EXPECT_EQ(2 * sizeof(uint64_t), usage.metadata);
+        EXPECT_GT(usage.overhead, 0);
+    }//TEST
+
+    TEST(GCounter, FlatContainers) {
+        GCounter<uint64_t, FlatContainers> cnt1, cnt2;
+        cnt1.replica_id(REPLICA1_ID);
+        cnt2.replica_id(REPLICA2_ID);
+        cnt1.increment();
+        cnt2.increment();
+        cnt2.increment();
+
+        cnt1.merge(cnt2);
+        EXPECT_EQ(3, cnt1.value());
+        EXPECT_GT(cnt1.memory_usage().overhead, 0);
+    }//TEST
+}//namespace
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "../core/hlc.hh"
+#include "../statebased/map.hh"
+
+namespace {
+    #define HLC_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    uint64_t fake_time = 0;
+
+    uint64_t fake_clock() {
+        return fake_time;
+    }
+
+    TEST(HybridLogicalClock, NowAndObserve) {
+        fake_time = 1000;
+        HybridLogicalClock clock1(REPLICA1_ID, fake_clock), clock2(REPLICA2_ID, fake_clock);
+        EXPECT_THROW(HybridLogicalClock(HybridLogicalClock::MAX_REPLICAS), std::out_of_range);
+
+        // Stamps of a clock increase while the physical time stands still
+        set_hybrid_clock(&clock1);
+        HLCTimestamp t1, t2;
+        t1.update();
+        for (auto i = 0; i < HLC_TEST_CASES; ++i) {
+            t2.update();
+            EXPECT_TRUE(t1 < t2);
+            t1 = t2;
+        }//for
+        EXPECT_EQ(REPLICA1_ID, t1.replica_id());
+        EXPECT_LE(1000, t1.physical_time());
+        EXPECT_EQ(HLC_TEST_CASES % (1 << HybridLogicalClock::LOGICAL_BITS), t1.logical());
+
+        // A clock that observes a stamp issues greater stamps, even if its physical time lags behind
+        set_hybrid_clock(&clock2);
+        fake_time = 900;
+        HLCTimestamp t3;
+        t3.merge(t1);
+        EXPECT_EQ(t1, t3);
+        t3.update();
+        EXPECT_TRUE(t1 < t3);
+        EXPECT_EQ(REPLICA2_ID, t3.replica_id());
+
+        std::stringstream stream;
+        t3.serialize(stream);
+        EXPECT_EQ(sizeof(uint64_t), stream.str().size());
+        HLCTimestamp read;
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_EQ(t3, read);
+        set_hybrid_clock(nullptr);
+    }//TEST
+
+    TEST(HybridLogicalClock, LastWriterWins) {
+        fake_time = 1000;
+        HybridLogicalClock clock1(REPLICA1_ID, fake_clock), clock2(REPLICA2_ID, fake_clock);
+
+        // A replica writes many times, and another replica writes once later; sequence numbers would order the
+        // earlier writes last, while hybrid stamps order the later write last
+        LWWRegister<std::string, HLCTimestamp> reg1, reg2;
+        set_hybrid_clock(&clock1);
+        for (auto i = 0; i < HLC_TEST_CASES; ++i)
+            reg1.assign("early " + std::to_string(i));
+        fake_time = 2000;
+        set_hybrid_clock(&clock2);
+        reg2.assign("late");
+
+        reg2.merge(reg1);
+        set_hybrid_clock(&clock1);
+        reg1.merge(reg2);
+        EXPECT_EQ("late", reg1.value());
+        EXPECT_EQ("late", reg2.value());
+        EXPECT_EQ(sizeof(uint64_t), reg1.memory_usage().metadata);
+
+        // Maps take the stamp type of their registers
+        Map<std::string, std::string, 0, StdContainers, HLCTimestamp> map1(REPLICA1_ID), map2(REPLICA2_ID);
+        map1.put("key", "value1");
+        set_hybrid_clock(&clock2);
+        map2.put("key", "value2");
+        map2.merge(map1);
+        set_hybrid_clock(&clock1);
+        map1.merge(map2);
+        EXPECT_EQ(map1.get("key"), map2.get("key"));
+        EXPECT_EQ("value2", map1.get("key"));
+        set_hybrid_clock(nullptr);
+    }//TEST
+
+    TEST(HybridLogicalClock, ConcurrentPutsConverge) {
+        // Replicas without a clock do not share one, which would stamp their writes alike
+        // A put or merge that cannot stamp its writes with the clock of the replica does not change the map
+        Map<std::string, std::string, 0, StdContainers, HLCTimestamp> map1(REPLICA1_ID), map2(REPLICA2_ID);
+        EXPECT_THROW(map1.put("key", "value"), std::logic_error);
+        EXPECT_THROW(HLCTimestamp().replica_id(HybridLogicalClock::MAX_REPLICAS), std::out_of_range);
+        fake_time = 1000;
+        HybridLogicalClock clock1(REPLICA1_ID, fake_clock), clock2(REPLICA2_ID, fake_clock);
+        set_hybrid_clock(&clock2);
+        EXPECT_THROW(map1.put("key", "value"), std::logic_error);
+        EXPECT_THROW(map1.emplace("key", 3, 'a'), std::logic_error);
+        map2.put("key", "value");
+        EXPECT_THROW(map1.merge(map2), std::logic_error);
+        EXPECT_FALSE(map1.contains("key"));
+        EXPECT_EQ(0, map1.size());
+        EXPECT_EQ(0, map1.context().max(REPLICA1_ID));
+        EXPECT_EQ(0, map1.context().max(REPLICA2_ID));
+
+        // Puts in the same millisecond differ in the replica bits of their stamps, so all replicas pick the put
+        // of the greater replica id
+        for (auto i = 0; i < HLC_TEST_CASES; ++i) {
+            auto key = "key" + std::to_string(i % 10);
+            set_hybrid_clock(&clock1);
+            map1.put(key, "value1 " + std::to_string(i));
+            set_hybrid_clock(&clock2);
+            map2.put(key, "value2 " + std::to_string(i));
+            if (i % 7 == 0)
+                map2.merge(map1);
+        }//for
+
+        set_hybrid_clock(&clock1);
+        map1.merge(map2);
+        set_hybrid_clock(&clock2);
+        map2.merge(map1);
+        EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
+        EXPECT_EQ("value2 " + std::to_string(HLC_TEST_CASES - 1), map1.get("key9"));
+        set_hybrid_clock(nullptr);
+    }//TEST
+}//namespace
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include "../statebased/incremental_merge.hh"
+
+namespace {
+    #define MERGE_TEST_CASES 1000
+    #define MERGE_STEP 7
+
+    /// Applies random add and remove operations to a given set
+    void random_operations(ORSet<std::string>& set, std::vector<std::string>& keys) {
+        for (int i = 0; i < MERGE_TEST_CASES; ++i) {
+            if (random() % 3 == 0 and !keys.empty()) {
+                auto rand_ind = random() % keys.size();
+                set.remove(keys[rand_ind]);
+            }//if
+            else {
+                keys.push_back(std::to_string(random() % (2 * MERGE_TEST_CASES)));
+                set.add(keys.back());
+            }//else
+        }//for
+    }
+
+    TEST(ORSetMerge, EqualsMerge) {
+        #define REPLICA1_ID 1
+        #define REPLICA2_ID 2
+        ORSet<std::string> set1(REPLICA1_ID);
+        ORSet<std::string> set2(REPLICA2_ID);
+        std::vector<std::string> keys;
+
+        random_operations(set1, keys);
+        set2.merge(set1);
+        random_operations(set1, keys);
+        random_operations(set2, keys);
+
+        auto merged = set1;
+        merged.merge(set2);
+
+        // Merge in bounded steps
+        ORSetMerge<std::string> merge(set1, set2);
+        size_t steps = 0;
+        while (!merge.step(MERGE_STEP))
+            ++steps;
+        EXPECT_TRUE(merge.done());
+        EXPECT_GT(steps, set1.size() / MERGE_STEP / 2);
+        EXPECT_TRUE(merged.elements() == set1.elements());
+
+        // The incrementally merged set converges with the remote set
+        set2.merge(set1);
+        set1.merge(set2);
+        EXPECT_TRUE(set1.elements() == set2.elements());
+    }//TEST
+
+    TEST(ORSetMerge, InterleavedLocalOperations) {
+        ORSet<std::string> set1(REPLICA1_ID);
+        ORSet<std::string> set2(REPLICA2_ID);
+        std::vector<std::string> keys;
+        random_operations(set2, keys);
+
+        // Add elements locally between steps; the local set is rehashed as it grows
+        ORSetMerge<std::string> merge(set1, set2);
+        std::vector<std::string> local;
+        while (!merge.step(MERGE_STEP)) {
+            local.push_back("local" + std::to_string(local.size()));
+            set1.add(local.back());
+        }//while
+
+        for (const auto& e: set2.elements())
+            EXPECT_TRUE(set1.contains(e));
+        for (const auto& e: local)
+            EXPECT_TRUE(set1.contains(e));
+        EXPECT_EQ(set2.size() + local.size(), set1.size());
+
+        // Elements removed remotely after observing them are removed by an incremental merge
+        set2.merge(set1);
+        for (const auto& e: local)
+            set2.remove(e);
+        ORSetMerge<std::string> remove_merge(set1, set2);
+        remove_merge.finish();
+        EXPECT_TRUE(set1.elements() == set2.elements());
+    }//TEST
+
+    TEST(MapMerge, EqualsMerge) {
+        Map<std::string, std::string> map1(REPLICA1_ID);
+        Map<std::string, std::string> map2(REPLICA2_ID);
+
+        for (int i = 0; i < MERGE_TEST_CASES; ++i) {
+            auto* p = (random() % 2 == 0) ? &map1 : &map2;
+            auto k = std::to_string(random() % MERGE_TEST_CASES);
+            if (random() % 4 == 0)
+                p->remove(k);
+            else
+                p->put(k, std::to_string(random()));
+
+            if (i == MERGE_TEST_CASES / 2) {
+                map1.merge(map2);
+                map2.merge(map1);
+            }//if
+        }//for
+
+        auto merged = map1;
+        merged.merge(map2);
+
+        MapMerge<std::string, std::string> merge(map1, map2);
+        while (!merge.step_for(std::chrono::microseconds(10))) { }
+        EXPECT_TRUE(merged.key_value_pairs() == map1.key_value_pairs());
+
+        // The incrementally merged map converges with the remote map
+        map2.merge(map1);
+        EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
+    }//TEST
+
+    TEST(MapMerge, BoundedSteps) {
+        // Each step merges at most the given number of elements, besides the rest of a bucket of local elements
+        Map<std::string, std::string> map1(REPLICA1_ID);
+        Map<std::string, std::string> map2(REPLICA2_ID);
+        for (int i = 0; i < 10 * MERGE_TEST_CASES; ++i) {
+            map1.put("local" + std::to_string(i), std::to_string(i));
+            map2.put(std::to_string(i), std::to_string(i));
+        }//for
+
+        auto merged = map1;
+        merged.merge(map2);
+
+        MapMerge<std::string, std::string> merge(map1, map2);
+        size_t steps = 0;
+        while (!merge.step(MERGE_STEP))
+            ++steps;
+        EXPECT_GE(steps + 1, (map1.size() + map2.size()) / MERGE_STEP);
+        EXPECT_TRUE(merged.key_value_pairs() == map1.key_value_pairs());
+    }//TEST
+
+    TEST(ORSetMerge, FlatContainers) {
+        ORSet<std::string, 0, FlatContainers> set1(REPLICA1_ID);
+        ORSet<std::string, 0, FlatContainers> set2(REPLICA2_ID);
+        for (int i = 0; i < MERGE_TEST_CASES; ++i)
+            set2.add(std::to_string(i));
+
+        // Local adds and removes between steps grow the flat table and reuse its deleted slots
+        ORSetMerge<std::string, 0, FlatContainers> merge(set1, set2);
+        std::vector<std::string> local;
+        while (!merge.step(MERGE_STEP)) {
+            local.push_back("local" + std::to_string(local.size()));
+            set1.add(local.back());
+            set1.remove("local" + std::to_string(local.size() / 2));
+        }//while
+
+        auto expected = set2.elements();
+        for (const auto& e: local) {
+            if (set1.contains(e))
+                expected.insert(e);
+        }//for
+        EXPECT_TRUE(set1.elements() == expected);
+
+        // Elements removed remotely are removed wherever the rehashes of the local table move them
+        set2.merge(set1);
+        for (int i = 0; i < MERGE_TEST_CASES; i += 2)
+            set2.remove(std::to_string(i));
+        ORSetMerge<std::string, 0, FlatContainers> remove_merge(set1, set2);
+        while (!remove_merge.step(MERGE_STEP)) {
+            local.push_back("local" + std::to_string(local.size()));
+            set1.add(local.back());
+        }//while
+        for (int i = 0; i < MERGE_TEST_CASES; ++i)
+            EXPECT_EQ(i % 2 == 1, set1.contains(std::to_string(i)));
+    }//TEST
+}//namespace
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "../statebased/incremental_merge.hh"
+#include "../statebased/map.hh"
+#include "../statebased/map_registry.hh"
+
+namespace {
+    #define INSTRUMENTATION_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    /// Records the events that it receives
+    class RecordingSink : public InstrumentationSink {
+    public:
+        uint64_t events{};
+        uint64_t phases{};
+
+        void count(Counter, uint64_t n) override {
+            events += n;
+        }
+
+        void elapsed(Phase, std::chrono::nanoseconds) override {
+            ++phases;
+        }
+    };
+
+    TEST(Instrumentation, ORSetMerge) {
+        ORSet<std::string> set1(REPLICA1_ID);
+        ORSet<std::string> set2(REPLICA2_ID);
+        for (int i = 0; i < INSTRUMENTATION_TEST_CASES; ++i) {
+            set1.add(std::to_string(i));
+            set2.add(std::to_string(i + INSTRUMENTATION_TEST_CASES / 2));
+        }//for
+        set1.merge(set2);
+        set2.merge(set1);
+        for (int i = 0; i < INSTRUMENTATION_TEST_CASES / 2; ++i)
+            set2.remove(std::to_string(i + INSTRUMENTATION_TEST_CASES / 2));
+
+        auto& counters = thread_counters();
+        counters.reset();
+        set1.merge(set2);
+
+        EXPECT_EQ(0, counters.get(Counter::OPERATIONS));
+        EXPECT_EQ(INSTRUMENTATION_TEST_CASES / 2, counters.get(Counter::ELEMENTS_ERASED));
+        EXPECT_EQ(0, counters.get(Counter::ELEMENTS_ADDED));
+        EXPECT_EQ(INSTRUMENTATION_TEST_CASES * 3 / 2 + set2.size(), counters.get(Counter::ELEMENTS_SCANNED));
+        EXPECT_EQ(0, counters.get(Counter::STAMPS_UPDATED));
+        EXPECT_GE(counters.get(Counter::HASH_PROBES), counters.get(Counter::ELEMENTS_SCANNED));
+        EXPECT_GT(counters.time(Phase::REMOVES).count(), 0);
+        EXPECT_GT(counters.time(Phase::ADDS).count(), 0);
+        EXPECT_EQ(0, counters.time(Phase::REGISTERS).count());
+    }//TEST
+
+    TEST(Instrumentation, MapOperationsAndMerge) {
+        Map<std::string, std::string> map1(REPLICA1_ID);
+        Map<std::string, std::string> map2(REPLICA2_ID);
+
+        auto& counters = thread_counters();
+        counters.reset();
+        for (int i = 0; i < INSTRUMENTATION_TEST_CASES; ++i)
+            map2.put(std::to_string(i), std::to_string(i));
+        // A put is an add to the keys and an assign to a register
+        EXPECT_EQ(2 * INSTRUMENTATION_TEST_CASES, counters.get(Counter::OPERATIONS));
+
+        counters.reset();
+        map1.merge(map2);
+        // Keys and registers received in a merge are not local operations
+        EXPECT_EQ(0, counters.get(Counter::OPERATIONS));
+        EXPECT_EQ(2 * INSTRUMENTATION_TEST_CASES, counters.get(Counter::ELEMENTS_ADDED));
+        EXPECT_GT(counters.time(Phase::REGISTERS).count(), 0);
+    }//TEST
+
+    TEST(Instrumentation, BoundedMergeSteps) {
+        #define MERGE_STEP 64
+        Map<std::string, std::string> map1(REPLICA1_ID);
+        Map<std::string, std::string> map2(REPLICA2_ID);
+        for (int i = 0; i < 10 * INSTRUMENTATION_TEST_CASES; ++i) {
+            map1.put("local" + std::to_string(i), std::to_string(i));
+            map2.put(std::to_string(i), std::to_string(i));
+        }//for
+
+        // The local tables are reserved when the merge is created, so no step rehashes them or restarts the scan
+        // of local elements: the elements are scanned once, at most about a step of them at a time
+        auto local_size = map1.size();
+        auto& counters = thread_counters();
+        MapMerge<std::string, std::string> merge(map1, map2);
+        uint64_t scanned = 0;
+        bool done = false;
+        while (!done) {
+            counters.reset();
+            done = merge.step(MERGE_STEP);
+            EXPECT_GE(2 * MERGE_STEP, counters.get(Counter::ELEMENTS_SCANNED));
+            EXPECT_GE(4 * MERGE_STEP, counters.get(Counter::HASH_PROBES));
+            scanned += counters.get(Counter::ELEMENTS_SCANNED);
+        }//while
+        EXPECT_EQ(local_size + 2 * map2.size(), scanned);
+        EXPECT_EQ(local_size + map2.size(), map1.size());
+    }//TEST
+
+    TEST(Instrumentation, RegistryDeltaMerge) {
+        MapRegistry<std::string, std::string> registry1(REPLICA1_ID);
+        MapRegistry<std::string, std::string> registry2(REPLICA2_ID);
+        for (int i = 0; i < INSTRUMENTATION_TEST_CASES; ++i)
+            registry1.put(i, "key", std::to_string(i));
+        registry2.merge(registry1);
+        registry1.put(0, "key", "changed");
+        registry1.put(0, "other", "added");
+
+        // Merging the delta of a tenant visits its entries only, not the entries of every tenant
+        auto& counters = thread_counters();
+        counters.reset();
+        registry2.merge_delta(registry1.delta(0));
+        EXPECT_EQ(2, counters.get(Counter::ELEMENTS_SCANNED));
+        EXPECT_EQ(1, counters.get(Counter::ELEMENTS_ADDED));
+        EXPECT_EQ("changed", registry2.get(0, "key"));
+    }//TEST
+
+    TEST(Instrumentation, Sink) {
+        RecordingSink sink;
+        set_instrumentation_sink(&sink);
+        ORSet<std::string> set1(REPLICA1_ID);
+        ORSet<std::string> set2(REPLICA2_ID);
+        set2.add("a");
+        set1.merge(set2);
+        set_instrumentation_sink(nullptr);
+
+        EXPECT_GT(sink.events, 0);
+        EXPECT_EQ(3, sink.phases);
+        EXPECT_EQ(&thread_counters(), &instrumentation_sink());
+    }//TEST
+}//namespace
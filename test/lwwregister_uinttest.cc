@@ -41,4 +41,24 @@ namespace {
             EXPECT_EQ(f->value(), s->value());
         }//for
     }//TEST
+
+    TEST(LWWRegister, MoveAndEmplace) {
+        LWWRegister<std::string> reg1;
+        LWWRegister<std::string> reg2;
+        reg1.replica_id(REPLICA1_ID);
+        reg2.replica_id(REPLICA2_ID);
+
+        std::string val(REGISTER_TEST_CASES, 'a');
+        reg1.assign(std::move(val));
+        EXPECT_EQ(std::string(REGISTER_TEST_CASES, 'a'), reg1.value());
+
+        reg2.emplace(REGISTER_TEST_CASES, 'b');
+        reg2.emplace(REGISTER_TEST_CASES, 'c');
+        EXPECT_EQ(std::string(REGISTER_TEST_CASES, 'c'), reg2.value());
+
+        // The newer remote value is moved to the local register
+        auto copy = reg2;
+        reg1.merge(std::move(copy));
+        EXPECT_EQ(reg2.value(), reg1.value());
+    }//TEST
 }//namespace
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "../statebased/map.hh"
+#include "../statebased/map_registry.hh"
+
+namespace {
+    #define REGISTRY_TEST_CASES 1000
+    #define REGISTRY_TENANTS 20
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    TEST(MapRegistry, PutGetAndRemove) {
+        MapRegistry<std::string, std::string> registry(REPLICA1_ID);
+        registry.put(1, "key", "value1");
+        registry.put(2, "key", "value2");
+        registry.put(2, "other", "value3");
+        EXPECT_EQ("value1", registry.get(1, "key"));
+        EXPECT_EQ("value2", registry.get(2, "key"));
+        EXPECT_FALSE(registry.contains(3, "key"));
+        EXPECT_THROW(registry.get(3, "key"), std::exception);
+        EXPECT_EQ(1, registry.size(1));
+        EXPECT_EQ(2, registry.size(2));
+        EXPECT_EQ(0, registry.size(3));
+
+        registry.put(1, "key", "changed");
+        EXPECT_EQ("changed", registry.get(1, "key"));
+        EXPECT_EQ(3, registry.size());
+        EXPECT_TRUE(registry.remove(2, "key"));
+        EXPECT_FALSE(registry.remove(2, "key"));
+        EXPECT_EQ(1, registry.remove_tenant(2));
+        EXPECT_EQ(0, registry.size(2));
+        EXPECT_TRUE(registry.key_value_pairs(1) == (std::unordered_map<std::string, std::string>{{"key", "changed"}}));
+    }//TEST
+
+    TEST(MapRegistry, MergeAsMap) {
+        // The registry behaves as a single Map whose keys are pairs of a tenant and a key
+        MapRegistry<std::string, std::string> registry1(REPLICA1_ID), registry2(REPLICA2_ID);
+        Map<std::string, std::string> map1(REPLICA1_ID), map2(REPLICA2_ID);
+        auto tenant_pairs = [](Map<std::string, std::string>& map, uint64_t tenant) {
+            std::unordered_map<std::string, std::string> result;
+            auto prefix = std::to_string(tenant) + "/";
+            for (const auto& kv: map.key_value_pairs()) {
+                if (kv.first.compare(0, prefix.size(), prefix) == 0)
+                    result.emplace(kv.first.substr(prefix.size()), kv.second);
+            }//for
+            return result;
+        };
+
+        for (int i = 0; i < REGISTRY_TEST_CASES; ++i) {
+            auto tenant = random() % REGISTRY_TENANTS;
+            auto key = std::to_string(random() % 10);
+            auto first = random() % 2 == 0;
+            auto& registry = first ? registry1 : registry2;
+            auto& map = first ? map1 : map2;
+            switch (random() % 5) {
+                case 0:
+                    registry.remove(tenant, key);
+                    map.remove(std::to_string(tenant) + "/" + key);
+                    break;
+                case 1:
+                    registry.merge(first ? registry2 : registry1);
+                    map.merge(first ? map2 : map1);
+                    break;
+                default:
+                    registry.put(tenant, key, std::to_string(i));
+                    map.put(std::to_string(tenant) + "/" + key, std::to_string(i));
+            }//switch
+            EXPECT_TRUE(registry.key_value_pairs(tenant) == tenant_pairs(map, tenant));
+        }//for
+
+        registry1.merge(registry2);
+        registry2.merge(registry1);
+        map1.merge(map2);
+        map2.merge(map1);
+        EXPECT_EQ(registry1.size(), registry2.size());
+        for (int i = 0; i < REGISTRY_TENANTS; ++i) {
+            EXPECT_TRUE(registry1.key_value_pairs(i) == tenant_pairs(map1, i));
+            EXPECT_TRUE(registry1.key_value_pairs(i) == registry2.key_value_pairs(i));
+        }//for
+    }//TEST
+
+    TEST(MapRegistry, BatchedDeltas) {
+        MapRegistry<std::string, std::string> registry1(REPLICA1_ID), registry2(REPLICA2_ID);
+        for (int i = 0; i < REGISTRY_TENANTS; ++i)
+            registry1.put(i, "key", "value" + std::to_string(i));
+        registry2.put(0, "local", "value");
+
+        // Ship the deltas of half of the tenants in a single stream
+        MapRegistry<std::string, std::string> batch(REPLICA1_ID);
+        for (int i = 0; i < REGISTRY_TENANTS; i += 2)
+            batch.merge(registry1.delta(i));
+        std::stringstream stream;
+        batch.serialize(stream);
+        MapRegistry<std::string, std::string> received(REPLICA2_ID);
+        ASSERT_TRUE(received.deserialize(stream));
+        registry2.merge(received);
+
+        EXPECT_EQ(REGISTRY_TENANTS / 2 + 1, registry2.size());
+        EXPECT_EQ("value0", registry2.get(0, "key"));
+        EXPECT_EQ("value", registry2.get(0, "local"));
+        EXPECT_FALSE(registry2.contains(1, "key"));
+
+        // Merging a delta without walking the local entries results in the same registry as a merge
+        registry1.put(1, "key", "changed");
+        auto merged = registry2;
+        merged.merge(registry1.delta(1));
+        registry2.merge_delta(registry1.delta(1));
+        for (int i = 0; i < REGISTRY_TENANTS; ++i)
+            EXPECT_TRUE(merged.key_value_pairs(i) == registry2.key_value_pairs(i));
+        EXPECT_EQ("changed", registry2.get(1, "key"));
+    }//TEST
+
+    TEST(MapRegistry, MemoryUsage) {
+        // A tiny map costs a few tens of bytes of metadata, far less than a Map of its own
+        HybridLogicalClock clock(REPLICA1_ID), other(REPLICA2_ID);
+        MapRegistry<std::string, std::string, 3, HLCTimestamp> registry(REPLICA1_ID);
+        EXPECT_THROW(registry.put(0, "key", "value"), std::logic_error);
+        set_hybrid_clock(&other);
+        EXPECT_THROW(registry.put(0, "key", "value"), std::logic_error);
+        EXPECT_EQ(0, registry.size());
+        set_hybrid_clock(&clock);
+        std::vector<Map<std::string, std::string, 3, StdContainers, HLCTimestamp>> maps;
+        for (int i = 0; i < REGISTRY_TEST_CASES; ++i) {
+            registry.put(i, "key", "value");
+            maps.emplace_back(REPLICA1_ID);
+            maps.back().put("key", "value");
+        }//for
+
+        auto usage = registry.memory_usage();
+        auto per_tenant = (usage.metadata + usage.overhead) / REGISTRY_TEST_CASES;
+        EXPECT_GT(100, per_tenant);
+        auto map_usage = maps.front().memory_usage();
+        EXPECT_LT(2 * per_tenant, map_usage.metadata + map_usage.overhead);
+        set_hybrid_clock(nullptr);
+    }//TEST
+}//namespace
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <sstream>
+#include <string_view>
 #include "../statebased/map.hh"
 
 namespace {
@@ -223,4 +225,333 @@ namespace {
         EXPECT_EQ(map1.size(), map2.size());
         EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
     }//TEST
-}//namespace
\ No newline at end of file
+
+    TEST(Map, RemoveAndPutAgain) {
+        Map<std::string, std::string> map1(REPLICA_ID);
+        Map<std::string, std::string> map2(REPLICA_ID + 1);
+        map1.put("key", "a");
+        map2.merge(map1);
+
+        // The value put again gets a new timestamp, not the timestamp of the removed value that map2 holds
+        map1.remove("key");
+        map1.put("key", "b");
+        map1.merge(map2);
+        map2.merge(map1);
+        EXPECT_EQ("b", map1.get("key"));
+        EXPECT_EQ("b", map2.get("key"));
+
+        // The clock of timestamps is restored with the state of the map
+        std::stringstream stream;
+        map1.serialize(stream);
+        Map<std::string, std::string> read(REPLICA_ID);
+        EXPECT_TRUE(read.deserialize(stream));
+        read.remove("key");
+        read.put("key", "c");
+        map2.merge(read);
+        EXPECT_EQ("c", map2.get("key"));
+    }//TEST
+
+    TEST(Map, MergeAll) {
+        #define MERGE_ALL_REPLICAS 8
+        std::vector<Map<std::string, std::string>> maps;
+        for (auto i = 0; i < MERGE_ALL_REPLICAS; ++i)
+            maps.emplace_back(i + 1);
+
+        // Random put and remove operations with occasional merges among replicas
+        for (auto i = 0; i < MAP_TEST_CASES; ++i) {
+            auto& map = maps[random() % maps.size()];
+            auto k = std::to_string(random() % MAP_TEST_CASES);
+            if (random() % 3 == 0)
+                map.remove(k);
+            else
+                map.put(k, std::to_string(random()));
+
+            if (random() % 50 == 0)
+                map.merge(maps[random() % maps.size()]);
+        }//for
+
+        // Merging all remote maps at once results in the same keys and values as merging them one by one
+        auto sequential = maps[0];
+        for (auto i = 1; i < MERGE_ALL_REPLICAS; ++i)
+            sequential.merge(maps[i]);
+
+        auto all = maps[0];
+        all.merge_all(maps.begin() + 1, maps.end());
+        EXPECT_TRUE(sequential.key_value_pairs() == all.key_value_pairs());
+
+        // Replicas converge after merging all others
+        for (auto& map: maps)
+            map.merge_all(maps.begin(), maps.end());
+        for (auto& map: maps)
+            map.merge_all(maps.begin(), maps.end());
+        for (auto& map: maps)
+            EXPECT_TRUE(maps[0].key_value_pairs() == map.key_value_pairs());
+    }//TEST
+
+    TEST(Map, MemoryUsage) {
+        Map<std::string, uint64_t> map(REPLICA_ID);
+        ORSet<std::string> keys(REPLICA_ID);
+        for (int i = 0; i < MAP_TEST_CASES; ++i) {
+            map.put(std::to_string(i), i);
+            keys.add(std::to_string(i));
+        }//for
+
+        // Keys are accounted as in a set, and each register adds its value and timestamp
+        auto usage = map.memory_usage();
+        EXPECT_EQ(keys.memory_usage().keys, usage.keys);
+        EXPECT_EQ(MAP_TEST_CASES * sizeof(uint64_t), usage.values);
+        EXPECT_EQ(keys.memory_usage().metadata + MAP_TEST_CASES * sizeof(Timestamp), usage.metadata);
+        EXPECT_GT(usage.overhead, keys.memory_usage().overhead);
+    }//TEST
+
+    TEST(Map, MoveMergeAndEmplace) {
+        Map<std::string, std::string> map1(REPLICA_ID);
+        Map<std::string, std::string> map2(REPLICA_ID + 1);
+        for (int i = 0; i < MAP_TEST_CASES; ++i) {
+            auto p = (random() % 2 == 0) ? &map1 : &map2;
+            auto k = std::to_string(random() % MAP_TEST_CASES);
+            if (random() % 4 == 0)
+                p->remove(k);
+            else
+                p->emplace(k, MAP_TEST_CASES, 'a' + random() % 26);
+        }//for
+
+        // Merging a map that is no longer needed results in the same map as merging a copy
+        auto copied = map1;
+        copied.merge(map2);
+        auto moved = map1;
+        auto remote = map2;
+        moved.merge(std::move(remote));
+        EXPECT_TRUE(copied.key_value_pairs() == moved.key_value_pairs());
+
+        // try_emplace does not overwrite an existing key
+        moved.put("key", "value");
+        EXPECT_FALSE(moved.try_emplace("key", "other"));
+        EXPECT_EQ("value", moved.get("key"));
+        EXPECT_TRUE(moved.try_emplace("other key", 3, 'a'));
+        EXPECT_EQ("aaa", moved.get("other key"));
+    }//TEST
+
+    TEST(Map, FixedReplicas) {
+        #define FIXED_REPLICAS 3
+        Map<std::string, std::string, FIXED_REPLICAS> map1(0);
+        Map<std::string, std::string, FIXED_REPLICAS> map2(FIXED_REPLICAS - 1);
+        for (int i = 0; i < MAP_TEST_CASES; ++i) {
+            auto p = (random() % 2 == 0) ? &map1 : &map2;
+            auto k = std::to_string(random() % MAP_TEST_CASES);
+            if (random() % 4 == 0)
+                p->remove(k);
+            else
+                p->put(k, std::to_string(random()));
+        }//for
+
+        map1.merge(map2);
+        map2.merge(map1);
+        EXPECT_EQ(map1.size(), map2.size());
+        EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
+
+        // The state of a map with a fixed number of replicas can be written and read
+        std::stringstream stream;
+        map1.serialize(stream);
+        Map<std::string, std::string, FIXED_REPLICAS> read(0);
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_TRUE(read.key_value_pairs() == map1.key_value_pairs());
+    }//TEST
+
+    TEST(Map, FlatContainers) {
+        #define REPLICA1_ID 1
+        #define REPLICA2_ID 2
+        Map<std::string, std::string, 0, FlatContainers> map1(REPLICA1_ID), map2(REPLICA2_ID);
+        for (int i = 0; i < MAP_TEST_CASES; ++i) {
+            auto p = (random() % 2 == 0) ? &map1 : &map2;
+            auto k = std::to_string(random() % MAP_TEST_CASES);
+            if (random() % 4 == 0)
+                p->remove(k);
+            else
+                p->put(k, std::to_string(random()));
+        }//for
+
+        map1.merge(map2);
+        map2.merge(Map<std::string, std::string, 0, FlatContainers>(map1));
+        EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
+
+        // Keys are looked up by std::string_view without constructing strings
+        std::string text = "key 17 and more";
+        map1.put("17", "seventeen");
+        EXPECT_TRUE(map1.contains(std::string_view(text).substr(4, 2)));
+        EXPECT_EQ("seventeen", map1.get(std::string_view(text).substr(4, 2)));
+
+        std::vector<std::string_view> keys = {"17", "not a key"};
+        auto values = map1.get_many(keys);
+        ASSERT_EQ(2, values.size());
+        EXPECT_EQ("seventeen", *values[0]);
+        EXPECT_EQ(nullptr, values[1]);
+        EXPECT_EQ(std::vector<bool>({true, false}), map1.contains_many(keys));
+
+        // The state of a map stored in flat tables can be written and read
+        std::stringstream stream;
+        map1.serialize(stream);
+        Map<std::string, std::string, 0, FlatContainers> read(0);
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_TRUE(read.key_value_pairs() == map1.key_value_pairs());
+    }//TEST
+
+    TEST(Map, NestedCRDTs) {
+        // Concurrent increments of a counter at the same key are added rather than overwritten
+        Map<std::string, GCounter<uint64_t>> counters1(REPLICA1_ID), counters2(REPLICA2_ID);
+        counters1.update("clicks", [](GCounter<uint64_t>& cnt) { cnt.increment(); });
+        counters2.update("clicks", [](GCounter<uint64_t>& cnt) { cnt.increment(); cnt.increment(); });
+        counters2.update("views", [](GCounter<uint64_t>& cnt) { cnt.increment(); });
+        counters1.merge(counters2);
+        EXPECT_EQ(3, counters1.get("clicks").value());
+        EXPECT_EQ(1, counters1.get("views").value());
+
+        // A delta ships the key and the local count of its counter only
+        counters2.update("clicks", [](GCounter<uint64_t>& cnt) { cnt.increment(); });
+        auto delta = counters2.delta("clicks");
+        EXPECT_EQ(1, delta.size());
+        EXPECT_EQ(3, delta.get("clicks").value());
+        counters1.merge(delta);
+        EXPECT_EQ(4, counters1.get("clicks").value());
+        EXPECT_EQ(1, counters1.get("views").value());
+
+        // Concurrent adds to a set at the same key are both kept
+        Map<std::string, ORSet<std::string>> sets1(REPLICA1_ID), sets2(REPLICA2_ID);
+        sets1.update("tags", [](ORSet<std::string>& set) { set.add("red"); });
+        sets2.update("tags", [](ORSet<std::string>& set) { set.add("blue"); });
+        sets2.merge(sets1.delta("tags", std::string("red")));
+        sets1.merge(sets2);
+        std::unordered_set<std::string> tags{"red", "blue"};
+        EXPECT_EQ(tags, sets1.get("tags").elements());
+        EXPECT_EQ(tags, sets2.get("tags").elements());
+
+        // The delta of a field of a nested map holds that field only
+        using Nested = Map<std::string, Map<std::string, GCounter<uint64_t>>>;
+        Nested nested1(REPLICA1_ID), nested2(REPLICA2_ID);
+        for (auto i = 0; i < MAP_TEST_CASES; ++i) {
+            nested1.update("user" + std::to_string(i % 10), [i](Map<std::string, GCounter<uint64_t>>& fields) {
+                fields.update("field" + std::to_string(i % 7), [](GCounter<uint64_t>& cnt) { cnt.increment(); });
+            });
+        }//for
+        nested2.merge(nested1);
+        nested1.update("user1", [](Map<std::string, GCounter<uint64_t>>& fields) {
+            fields.update("field1", [](GCounter<uint64_t>& cnt) { cnt.increment(); });
+        });
+
+        std::stringstream full, field;
+        nested1.serialize(full);
+        auto field_delta = nested1.delta("user1", std::string("field1"));
+        field_delta.serialize(field);
+        EXPECT_LT(field.str().size() * 10, full.str().size());
+
+        nested2.merge(field_delta);
+        EXPECT_EQ(nested1.get("user1").get("field1").value(), nested2.get("user1").get("field1").value());
+        EXPECT_EQ(nested1.get("user1").get("field2").value(), nested2.get("user1").get("field2").value());
+
+        // Nested values are written and read with the map
+        Nested read(0);
+        ASSERT_TRUE(read.deserialize(full));
+        EXPECT_EQ(nested1.get("user1").get("field1").value(), read.get("user1").get("field1").value());
+        EXPECT_EQ(10, read.size());
+    }//TEST
+
+    TEST(Map, NestedRemoveAndAddAgain) {
+        #define REPLICA3_ID 3
+        auto add = [](const std::string& e) { return [e](ORSet<std::string>& set) { set.add(e); }; };
+
+        // Keys of counters cannot be removed, since a counter created again would continue from the old counts
+        static_assert(!IsRemovableValue<GCounter<uint64_t>>::value);
+        static_assert(!IsRemovableValue<Map<std::string, GCounter<uint64_t>>>::value);
+        static_assert(IsRemovableValue<Map<std::string, ORSet<std::string>>>::value);
+
+        // A set created again for a removed key tags its adds with new dots, so a replica that observed the dots
+        // of the removed set does not take the new elements as removed
+        Map<std::string, ORSet<std::string>> sets1(REPLICA1_ID), sets3(REPLICA3_ID);
+        sets1.update("tags", add("red"));
+        sets3.merge(sets1);
+        sets1.remove("tags");
+        sets1.update("tags", add("blue"));
+        sets3.merge(sets1);
+        sets1.merge(sets3);
+        std::unordered_set<std::string> tags{"blue"};
+        EXPECT_EQ(tags, sets1.get("tags").elements());
+        EXPECT_EQ(tags, sets3.get("tags").elements());
+
+        // The same holds for a key removed by merging a remote remove
+        sets3.remove("tags");
+        sets1.merge(sets3);
+        EXPECT_FALSE(sets1.contains("tags"));
+        sets1.update("tags", add("green"));
+        sets3.merge(sets1);
+        sets1.merge(sets3);
+        tags = {"green"};
+        EXPECT_EQ(tags, sets1.get("tags").elements());
+        EXPECT_EQ(tags, sets3.get("tags").elements());
+
+        // and for a map read from a stream after the key was removed
+        sets1.remove("tags");
+        std::stringstream stream;
+        sets1.serialize(stream);
+        Map<std::string, ORSet<std::string>> read(REPLICA1_ID);
+        ASSERT_TRUE(read.deserialize(stream));
+        read.update("tags", add("yellow"));
+        sets3.merge(read);
+        tags = {"yellow"};
+        EXPECT_EQ(tags, sets3.get("tags").elements());
+
+        // The sets of nested maps continue from the dots issued in the removed map
+        using Nested = Map<std::string, Map<std::string, ORSet<std::string>>>;
+        auto add_field = [](const std::string& e) {
+            return [e](Map<std::string, ORSet<std::string>>& fields) {
+                fields.update("tags", [e](ORSet<std::string>& set) { set.add(e); });
+            };
+        };
+        Nested nested1(REPLICA1_ID), nested3(REPLICA3_ID);
+        nested1.update("user", add_field("red"));
+        nested3.merge(nested1);
+        nested1.remove("user");
+        nested1.update("user", add_field("blue"));
+        nested3.merge(nested1);
+        tags = {"blue"};
+        EXPECT_EQ(tags, nested3.get("user").get("tags").elements());
+
+        // Removed keys leave no state behind
+        Map<std::string, ORSet<std::string>> removed(REPLICA1_ID);
+        auto remove_keys = [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                removed.update(std::to_string(i), add("red"));
+                removed.remove(std::to_string(i));
+            }//for
+        };
+        remove_keys(0, MAP_TEST_CASES);
+        auto usage = removed.memory_usage().total();
+        auto serialized_size = [&]() {
+            std::stringstream stream;
+            removed.serialize(stream);
+            return stream.str().size();
+        };
+        auto size = serialized_size();
+        remove_keys(MAP_TEST_CASES, 2 * MAP_TEST_CASES);
+        EXPECT_EQ(usage, removed.memory_usage().total());
+        EXPECT_GE(size + 2, serialized_size());
+    }//TEST
+
+    TEST(Map, SyncWithSummary) {
+        Map<std::string, std::string> map1(REPLICA1_ID), map2(REPLICA2_ID);
+        map1.enable_summary(20);
+        for (int i = 0; i < MAP_TEST_CASES; ++i)
+            map1.put("k" + std::to_string(i), "v");
+        map2.merge(map1);
+
+        // The state holds the keys and values changed since the remote replica synced, and removes are carried
+        // by the summary
+        map1.put("k0", "changed");
+        map1.remove("k1");
+        auto state = map1.sync_state(map2.context());
+        EXPECT_EQ(1, state.size());
+        map2.merge_sync(state, map1.summary());
+        EXPECT_EQ("changed", map2.get("k0"));
+        EXPECT_FALSE(map2.contains("k1"));
+        EXPECT_TRUE(map1.key_value_pairs() == map2.key_value_pairs());
+    }//TEST
+}//namespace
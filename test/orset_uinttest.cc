@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <string_view>
 #include "../statebased/orset.hh"
 
 namespace {
@@ -189,4 +190,267 @@ namespace {
             EXPECT_TRUE(set2.contains(b));
         }//for
     }//TEST
+
+    TEST(ORSet, MergeAll) {
+        #define MERGE_ALL_REPLICAS 8
+        std::vector<ORSet<std::string>> sets;
+        for (auto i = 0; i < MERGE_ALL_REPLICAS; ++i)
+            sets.emplace_back(i + 1);
+
+        // Random add and remove operations with occasional merges among replicas
+        std::vector<std::string> keys;
+        for (auto i = 0; i < SET_TEST_CASES; ++i) {
+            auto& set = sets[random() % sets.size()];
+            if (random() % 3 == 0 and !keys.empty()) {
+                set.remove(keys[random() % keys.size()]);
+            }//if
+            else {
+                keys.push_back(std::to_string(random() % SET_TEST_CASES));
+                set.add(keys.back());
+            }//else
+
+            if (random() % 50 == 0)
+                set.merge(sets[random() % sets.size()]);
+        }//for
+
+        // Merging all remote sets at once equals merging them one by one
+        auto sequential = sets[0];
+        for (auto i = 1; i < MERGE_ALL_REPLICAS; ++i)
+            sequential.merge(sets[i]);
+
+        auto all = sets[0];
+        all.merge_all(sets.begin() + 1, sets.end());
+        EXPECT_TRUE(sequential.elements() == all.elements());
+
+        // Replicas converge after merging all others
+        for (auto& set: sets)
+            set.merge_all(sets.begin(), sets.end());
+        for (auto& set: sets)
+            set.merge_all(sets.begin(), sets.end());
+        for (const auto& set: sets)
+            EXPECT_TRUE(sets[0].elements() == set.elements());
+    }//TEST
+
+    TEST(ORSet, MemoryUsage) {
+        ORSet<std::string> set(REPLICA_ID);
+        auto empty = set.memory_usage();
+        EXPECT_EQ(0, empty.keys);
+        EXPECT_EQ(0, empty.values);
+
+        for (int i = 0; i < SET_TEST_CASES; ++i)
+            set.add(std::string(64, 'a') + std::to_string(i));
+        auto usage = set.memory_usage();
+        EXPECT_GE(usage.keys, SET_TEST_CASES * (sizeof(std::string) + 64));
+        EXPECT_GE(usage.metadata, SET_TEST_CASES * 2 * sizeof(uint64_t));
+        EXPECT_GT(usage.overhead, empty.overhead);
+        EXPECT_EQ(usage.keys + usage.metadata + usage.overhead, usage.total());
+        EXPECT_GT(usage.metadata_ratio(), 0);
+
+        // Removing elements releases their keys and tags
+        for (int i = 0; i < SET_TEST_CASES; ++i)
+            set.remove(std::string(64, 'a') + std::to_string(i));
+        EXPECT_EQ(0, set.memory_usage().keys);
+    }//TEST
+
+    TEST(ORSet, MoveMerge) {
+        ORSet<std::string> set1(REPLICA_ID);
+        ORSet<std::string> set2(REPLICA2_ID);
+        std::vector<std::string> keys;
+        for (int i = 0; i < SET_TEST_CASES; ++i) {
+            auto p = (random() % 2 == 0) ? &set1 : &set2;
+            if (random() % 3 == 0 and !keys.empty()) {
+                p->remove(keys[random() % keys.size()]);
+            }//if
+            else {
+                keys.push_back(std::to_string(random() % SET_TEST_CASES));
+                p->emplace(keys.back());
+            }//else
+
+            if (i == SET_TEST_CASES / 2) {
+                set1.merge(set2);
+                set2.merge(set1);
+            }//if
+        }//for
+
+        // Merging a set that is no longer needed results in the same set as merging a copy
+        auto copied = set1;
+        copied.merge(set2);
+        auto moved = set1;
+        auto remote = set2;
+        moved.merge(std::move(remote));
+        EXPECT_TRUE(copied.elements() == moved.elements());
+        EXPECT_TRUE(copied.context() == moved.context());
+
+        // An element added by an rvalue is added as a copied element
+        moved.add(std::string("moved"));
+        EXPECT_TRUE(moved.contains("moved"));
+        copied.merge(moved);
+        EXPECT_TRUE(copied.elements() == moved.elements());
+    }//TEST
+
+    TEST(ORSet, FixedReplicas) {
+        #define FIXED_REPLICAS 3
+        // Sets with a fixed number of replicas behave as sets with any number of replicas
+        std::vector<ORSet<std::string, FIXED_REPLICAS>> fixed;
+        std::vector<ORSet<std::string>> dynamic;
+        for (auto i = 0; i < FIXED_REPLICAS; ++i) {
+            fixed.emplace_back(i);
+            dynamic.emplace_back(i);
+        }//for
+
+        for (int i = 0; i < SET_TEST_CASES; ++i) {
+            auto r = random() % FIXED_REPLICAS;
+            auto e = std::to_string(random() % (SET_TEST_CASES / 10));
+            switch (random() % 4) {
+                case 0:
+                    fixed[r].remove(e);
+                    dynamic[r].remove(e);
+                    break;
+                case 1: {
+                    auto other = random() % FIXED_REPLICAS;
+                    fixed[r].merge(fixed[other]);
+                    dynamic[r].merge(dynamic[other]);
+                    break;
+                }
+                default:
+                    fixed[r].add(e);
+                    dynamic[r].add(e);
+            }//switch
+            EXPECT_TRUE(fixed[r].elements() == dynamic[r].elements());
+        }//for
+
+        // Tags are stored inline in a few bytes per element
+        auto fixed_usage = fixed[0].memory_usage();
+        auto dynamic_usage = dynamic[0].memory_usage();
+        EXPECT_EQ(fixed[0].size() * FIXED_REPLICAS * sizeof(uint64_t) + fixed[0].context().memory_usage().metadata,
+                  fixed_usage.metadata);
+        EXPECT_LT(fixed_usage.metadata + fixed_usage.overhead, dynamic_usage.metadata + dynamic_usage.overhead);
+
+        // Replica ids must be less than the number of replicas
+        EXPECT_THROW((ORSet<std::string, FIXED_REPLICAS>(FIXED_REPLICAS)), std::out_of_range);
+    }//TEST
+
+    TEST(ORSet, FlatContainers) {
+        #define REPLICA1_ID 1
+        #define REPLICA2_ID 2
+        // Sets stored in flat tables behave as sets stored in std::unordered_map
+        ORSet<std::string, 0, FlatContainers> flat1(REPLICA1_ID), flat2(REPLICA2_ID);
+        ORSet<std::string> std1(REPLICA1_ID), std2(REPLICA2_ID);
+        for (int i = 0; i < SET_TEST_CASES; ++i) {
+            auto e = std::to_string(random() % (SET_TEST_CASES / 10));
+            auto first = random() % 2 == 0;
+            auto& flat = first ? flat1 : flat2;
+            auto& std = first ? std1 : std2;
+            switch (random() % 5) {
+                case 0:
+                    flat.remove(e);
+                    std.remove(e);
+                    break;
+                case 1:
+                    flat.merge(first ? flat2 : flat1);
+                    std.merge(first ? std2 : std1);
+                    break;
+                case 2:
+                    flat.merge(ORSet<std::string, 0, FlatContainers>(first ? flat2 : flat1));
+                    std.merge(ORSet<std::string>(first ? std2 : std1));
+                    break;
+                default:
+                    flat.add(e);
+                    std.add(e);
+            }//switch
+            EXPECT_TRUE(flat.elements() == std.elements());
+        }//for
+
+        // Elements are looked up by std::string_view, one by one or in batches
+        std::vector<std::string> std_lookups;
+        for (int i = 0; i < SET_TEST_CASES / 5; ++i)
+            std_lookups.push_back(std::to_string(i));
+        std::vector<std::string_view> lookups(std_lookups.begin(), std_lookups.end());
+        for (size_t i = 0; i < lookups.size(); ++i)
+            EXPECT_EQ(std1.contains(std_lookups[i]), flat1.contains(lookups[i]));
+        EXPECT_TRUE(flat1.contains_many(lookups) == std1.contains_many(std_lookups));
+        EXPECT_TRUE(flat1.contains_many(std_lookups) == std1.contains_many(std_lookups));
+    }//TEST
+
+    TEST(ORSet, Summary) {
+        // Sets with summaries behave as sets without them, although the summaries are rebuilt as they grow
+        ORSet<std::string> summarized1(REPLICA1_ID), summarized2(REPLICA2_ID);
+        ORSet<std::string> plain1(REPLICA1_ID), plain2(REPLICA2_ID);
+        summarized1.enable_summary();
+        summarized2.enable_summary(4);
+        for (int i = 0; i < SET_TEST_CASES; ++i) {
+            auto e = std::to_string(random() % (SET_TEST_CASES / 2));
+            auto first = random() % 2 == 0;
+            auto& summarized = first ? summarized1 : summarized2;
+            auto& plain = first ? plain1 : plain2;
+            switch (random() % 5) {
+                case 0:
+                    summarized.remove(e);
+                    plain.remove(e);
+                    break;
+                case 1:
+                    summarized.merge(first ? summarized2 : summarized1);
+                    plain.merge(first ? plain2 : plain1);
+                    break;
+                default:
+                    summarized.add(e);
+                    plain.add(e);
+            }//switch
+            EXPECT_EQ(plain.contains(e), summarized.contains(e));
+            EXPECT_TRUE(summarized.elements() == plain.elements());
+        }//for
+        EXPECT_LT(0, summarized1.memory_usage().metadata - plain1.memory_usage().metadata);
+    }//TEST
+
+    TEST(ORSet, MoveMergeIntoSummary) {
+        // Moving many elements into a small summarized set rebuilds its summary on the way; every moved element
+        // enters the table before the summary, so a rebuild covers it
+        ORSet<std::string> small(REPLICA1_ID), large(REPLICA2_ID), peer(REPLICA2_ID);
+        small.enable_summary();
+        for (int i = 0; i < 10; ++i)
+            small.add("small" + std::to_string(i));
+        for (int i = 0; i < SET_TEST_CASES; ++i)
+            large.add(std::to_string(i));
+        peer.merge(large);
+        small.merge(std::move(large));
+        for (int i = 0; i < SET_TEST_CASES; ++i)
+            EXPECT_TRUE(small.contains(std::to_string(i)));
+
+        // A peer that merges the summarized set does not take its elements for removed
+        peer.merge(small);
+        EXPECT_EQ(SET_TEST_CASES + 10, peer.size());
+        EXPECT_TRUE(peer.elements() == small.elements());
+    }//TEST
+
+    TEST(ORSet, SyncWithSummary) {
+        ORSet<std::string> set1(REPLICA1_ID), set2(REPLICA2_ID);
+        set1.enable_summary(20);
+        for (int i = 0; i < SET_TEST_CASES; ++i)
+            set1.add("e" + std::to_string(i));
+        set2.merge(set1);
+
+        // The state for a replica that observed every add holds no element
+        EXPECT_EQ(0, set1.sync_state(set2.context()).size());
+
+        // After a few adds and removes, the state holds the added elements only, and the summary carries removes
+        for (int i = 0; i < 10; ++i) {
+            set1.remove("e" + std::to_string(i));
+            set1.add("new" + std::to_string(i));
+        }//for
+        set2.add("concurrent");
+        auto state = set1.sync_state(set2.context());
+        EXPECT_EQ(10, state.size());
+        set2.merge_sync(state, set1.summary());
+        set1.add("concurrent");
+        EXPECT_TRUE(set1.elements() == set2.elements());
+
+        // Without a summary of the remote set, removes are deferred to a later merge
+        ORSet<std::string> set3(3);
+        set3.merge(set2);
+        set2.remove("e10");
+        set3.merge_sync(set2.sync_state(set3.context()), BloomFilter());
+        EXPECT_TRUE(set3.contains("e10"));
+        set3.merge(set2);
+        EXPECT_FALSE(set3.contains("e10"));
+    }//TEST
 }//namespace
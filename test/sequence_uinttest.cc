@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <sstream>
+#include <string>
+#include "../statebased/sequence.hh"
+
+namespace {
+    #define SEQUENCE_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+    #define REPLICA3_ID 3
+
+    std::string text(const Sequence<char>& seq) {
+        auto values = seq.values();
+        return std::string(values.begin(), values.end());
+    }
+
+    void insert(Sequence<char>& seq, size_t pos, const std::string& str) {
+        seq.insert(pos, str.begin(), str.end());
+    }
+
+    TEST(Sequence, InsertAndErase) {
+        Sequence<char> seq(REPLICA1_ID);
+        std::string expected;
+        for (auto i = 0; i < SEQUENCE_TEST_CASES; ++i) {
+            if (expected.empty() or random() % 3 != 0) {
+                auto pos = random() % (expected.size() + 1);
+                std::string str(random() % 5 + 1, static_cast<char>('a' + random() % 26));
+                insert(seq, pos, str);
+                expected.insert(pos, str);
+            }//if
+            else {
+                auto pos = random() % expected.size();
+                auto count = std::min<size_t>(random() % 5 + 1, expected.size() - pos);
+                seq.erase(pos, count);
+                expected.erase(pos, count);
+            }//else
+        }//for
+
+        EXPECT_EQ(expected, text(seq));
+        ASSERT_EQ(expected.size(), seq.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+            EXPECT_EQ(expected[i], seq.at(i));
+        EXPECT_THROW(seq.at(seq.size()), std::out_of_range);
+        EXPECT_THROW(seq.erase(seq.size(), 1), std::out_of_range);
+        EXPECT_THROW(seq.insert(seq.size() + 1, 'a'), std::out_of_range);
+    }//TEST
+
+    TEST(Sequence, RunLengthBlocks) {
+        Sequence<char> seq1(REPLICA1_ID), seq2(REPLICA2_ID);
+        for (size_t i = 0; i < SEQUENCE_TEST_CASES; ++i)
+            seq1.insert(i, static_cast<char>('a' + i % 26));
+        EXPECT_EQ(1, seq1.blocks());
+        EXPECT_EQ(SEQUENCE_TEST_CASES, seq1.size());
+
+        // Removing from the middle splits the block in three, and merged items stay in a single block
+        seq1.erase(10, 5);
+        EXPECT_EQ(3, seq1.blocks());
+        seq2.merge(seq1);
+        EXPECT_EQ(3, seq2.blocks());
+        EXPECT_EQ(text(seq1), text(seq2));
+
+        // Typing continued after a merge extends the merged block
+        seq1.insert(seq1.size(), 'x');
+        seq1.insert(seq1.size(), 'y');
+        seq2.merge(seq1);
+        EXPECT_EQ(3, seq2.blocks());
+        EXPECT_EQ(text(seq1), text(seq2));
+    }//TEST
+
+    TEST(Sequence, ConcurrentInsertsDoNotInterleave) {
+        Sequence<char> seq1(REPLICA1_ID), seq2(REPLICA2_ID);
+        insert(seq1, 0, "ab");
+        seq2.merge(seq1);
+        insert(seq1, 1, "xyz");
+        insert(seq2, 1, "123");
+        seq2.erase(0);
+        seq1.merge(seq2);
+        seq2.merge(seq1);
+
+        EXPECT_EQ(text(seq1), text(seq2));
+        EXPECT_TRUE(text(seq1) == "xyz123b" or text(seq1) == "123xyzb");
+    }//TEST
+
+    TEST(Sequence, Merge) {
+        std::vector<Sequence<char>> seqs{Sequence<char>(REPLICA1_ID), Sequence<char>(REPLICA2_ID),
+                                         Sequence<char>(REPLICA3_ID)};
+        for (auto i = 0; i < SEQUENCE_TEST_CASES; ++i) {
+            auto& seq = seqs[random() % seqs.size()];
+            auto op = random() % 4;
+            if (op == 0) {
+                seq.merge(seqs[random() % seqs.size()]);
+            }//if
+            else if (op == 1 and seq.size() > 0) {
+                auto pos = random() % seq.size();
+                seq.erase(pos, std::min<size_t>(random() % 3 + 1, seq.size() - pos));
+            }//else if
+            else {
+                insert(seq, random() % (seq.size() + 1), std::string(random() % 3 + 1, 'a' + random() % 26));
+            }//else
+        }//for
+
+        for (auto& seq1: seqs) {
+            for (auto& seq2: seqs)
+                seq1.merge(seq2);
+        }//for
+        for (auto& seq: seqs) {
+            seq.merge(seqs[0]);
+            EXPECT_EQ(text(seqs[0]), text(seq));
+        }//for
+    }//TEST
+
+    TEST(Sequence, SerializeAndMemoryUsage) {
+        Sequence<std::string> seq1(REPLICA1_ID), seq2(REPLICA2_ID), read(REPLICA2_ID);
+        std::vector<std::string> words{"a", "replicated", "growable", "array"};
+        seq1.insert(0, words);
+        seq2.merge(seq1);
+        seq2.erase(1);
+        seq2.insert(0, std::string("the"));
+
+        std::stringstream stream;
+        seq2.serialize(stream);
+        ASSERT_TRUE(read.deserialize(stream));
+        EXPECT_EQ(seq2.values(), read.values());
+        EXPECT_EQ(seq2.blocks(), read.blocks());
+        EXPECT_EQ(REPLICA2_ID, read.replica_id());
+
+        seq1.merge(read);
+        EXPECT_EQ(seq2.values(), seq1.values());
+        EXPECT_EQ(seq2.memory_usage().metadata, seq1.memory_usage().metadata);
+        EXPECT_GT(seq1.memory_usage().values, 3 * sizeof(std::string));
+
+        std::stringstream truncated(stream.str().substr(0, stream.str().size() / 2));
+        EXPECT_FALSE(read.deserialize(truncated));
+    }//TEST
+
+    TEST(Sequence, CorruptedBlockLength) {
+        // A block whose length exceeds its values fails at the end of the stream instead of allocating the length
+        Sequence<char> read(REPLICA2_ID);
+        std::stringstream stream;
+        Serializer<uint64_t>::write(stream, REPLICA1_ID);
+        Serializer<uint64_t>::write(stream, UINT64_MAX);
+        Serializer<uint64_t>::write(stream, 1);
+        for (uint64_t field: {REPLICA1_ID, 1, 0, 0})
+            Serializer<uint64_t>::write(stream, field);
+        Serializer<uint64_t>::write(stream, UINT64_MAX / 2);
+        Serializer<bool>::write(stream, false);
+        stream.write("abc", 3);
+        EXPECT_FALSE(read.deserialize(stream));
+        EXPECT_EQ(0, read.size());
+    }//TEST
+
+    TEST(Sequence, CorruptedBlockDots) {
+        // Writes a sequence of single items given by their dots and the dots of their origins
+        auto write = [](std::stringstream& stream, uint64_t clock,
+                        std::initializer_list<std::array<uint64_t, 5>> blocks) {
+            Serializer<uint64_t>::write(stream, REPLICA1_ID);
+            Serializer<uint64_t>::write(stream, clock);
+            Serializer<uint64_t>::write(stream, blocks.size());
+            for (const auto& block: blocks) {
+                for (auto field: block)
+                    Serializer<uint64_t>::write(stream, field);
+                Serializer<bool>::write(stream, false);
+                for (uint64_t v = 0; v < block[4]; ++v)
+                    stream.put('a');
+            }//for
+        };
+
+        Sequence<char> read(REPLICA2_ID);
+        std::stringstream valid;
+        write(valid, 3, {{REPLICA1_ID, 1, 0, 0, 2}, {REPLICA2_ID, 3, REPLICA1_ID, 2, 1}});
+        EXPECT_TRUE(read.deserialize(valid));
+        EXPECT_EQ("aaa", text(read));
+
+        // The origin of an item must be read before it
+        std::stringstream missing_origin;
+        write(missing_origin, 3, {{REPLICA1_ID, 1, 0, 0, 1}, {REPLICA2_ID, 3, REPLICA1_ID, 2, 1}});
+        EXPECT_FALSE(read.deserialize(missing_origin));
+        EXPECT_EQ("aaa", text(read));
+
+        std::stringstream overlapping_before;
+        write(overlapping_before, 3, {{REPLICA1_ID, 1, 0, 0, 2}, {REPLICA1_ID, 2, REPLICA1_ID, 1, 1}});
+        EXPECT_FALSE(read.deserialize(overlapping_before));
+
+        std::stringstream overlapping_after;
+        write(overlapping_after, 3, {{REPLICA1_ID, 2, 0, 0, 1}, {REPLICA1_ID, 1, 0, 0, 2}});
+        EXPECT_FALSE(read.deserialize(overlapping_after));
+
+        // The last sequence number of a block must not wrap around or exceed the clock
+        std::stringstream overflow;
+        write(overflow, UINT64_MAX, {{REPLICA1_ID, UINT64_MAX, 0, 0, 2}});
+        EXPECT_FALSE(read.deserialize(overflow));
+
+        std::stringstream after_clock;
+        write(after_clock, 1, {{REPLICA1_ID, 1, 0, 0, 2}});
+        EXPECT_FALSE(read.deserialize(after_clock));
+        EXPECT_EQ("aaa", text(read));
+
+        // A sequence read successfully merges remote items into its blocks
+        Sequence<char> seq(REPLICA1_ID);
+        seq.merge(read);
+        insert(seq, 1, "b");
+        read.merge(seq);
+        EXPECT_EQ("abaa", text(read));
+    }//TEST
+}//namespace
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "../core/shared_value.hh"
+#include "../statebased/map.hh"
+
+namespace {
+    #define SHARED_VALUE_TEST_CASES 1000
+    #define VALUE_SIZE 4096
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    TEST(SharedValue, CopySharesBuffer) {
+        SharedValue<std::string> v1(std::string(VALUE_SIZE, 'a'));
+        auto v2 = v1;
+        EXPECT_EQ(v1.ptr(), v2.ptr());
+        EXPECT_TRUE(v1 == v2);
+        EXPECT_EQ(std::string(VALUE_SIZE, 'a'), v2.get());
+
+        SharedValue<std::string> empty;
+        EXPECT_EQ("", empty.get());
+        EXPECT_TRUE(empty != v1);
+    }//TEST
+
+    TEST(SharedValue, MemoryUsage) {
+        // A buffer that is not interned is counted by each value holding it, however many share it
+        SharedValue<std::string> v1(std::string(VALUE_SIZE, 'a'));
+        auto size = footprint(v1);
+        EXPECT_LT(VALUE_SIZE, size);
+        {
+            auto v2 = v1;
+            EXPECT_EQ(size, footprint(v1));
+            EXPECT_EQ(size, footprint(v2));
+        }
+        EXPECT_EQ(size, footprint(v1));
+
+        // An interned buffer is counted by its pool only
+        ValuePool<std::string> pool;
+        auto v3 = pool.intern(v1);
+        EXPECT_TRUE(v3.pooled());
+        EXPECT_FALSE(v1.pooled());
+        EXPECT_EQ(sizeof(v3), footprint(v3));
+        EXPECT_LT(VALUE_SIZE, pool.memory_usage().values);
+        EXPECT_EQ(sizeof(SharedValue<std::string>), footprint(SharedValue<std::string>()));
+    }//TEST
+
+    TEST(ValuePool, Intern) {
+        ValuePool<std::string> pool;
+        auto v1 = pool.intern(std::string(VALUE_SIZE, 'a'));
+        auto v2 = pool.intern(std::string(VALUE_SIZE, 'a'));
+        auto v3 = pool.intern(std::string(VALUE_SIZE, 'b'));
+        EXPECT_EQ(v1.ptr(), v2.ptr());
+        EXPECT_NE(v1.ptr(), v3.ptr());
+
+        // A value read from elsewhere shares the buffer of an equal interned value
+        SharedValue<std::string> other(std::string(VALUE_SIZE, 'a'));
+        EXPECT_EQ(v1.ptr(), pool.intern(other).ptr());
+
+        // Released values are purged
+        for (int i = 0; i < SHARED_VALUE_TEST_CASES; ++i)
+            pool.intern(std::to_string(i));
+        pool.purge();
+        EXPECT_EQ(2, pool.size());
+    }//TEST
+
+    TEST(SharedValue, MapSharesValues) {
+        ValuePool<std::string> pool;
+        Map<std::string, SharedValue<std::string>> map1(REPLICA1_ID);
+        Map<std::string, SharedValue<std::string>> map2(REPLICA2_ID);
+        for (int i = 0; i < SHARED_VALUE_TEST_CASES; ++i)
+            map1.put(std::to_string(i), pool.intern(std::string(VALUE_SIZE, 'a' + i % 2)));
+
+        // Equal values share two buffers, and merges and snapshots share buffers instead of copying them
+        map2.merge(map1);
+        auto snapshot = map2.key_value_pairs();
+        for (const auto& kv: map1.key_value_pairs())
+            EXPECT_EQ(kv.second.ptr(), snapshot[kv.first].ptr());
+        // The map only counts its references to the buffers, whatever other objects share them, and the pool
+        // counts each buffer once
+        auto usage = map1.memory_usage();
+        EXPECT_LT(usage.values, SHARED_VALUE_TEST_CASES * VALUE_SIZE / 10);
+        snapshot.clear();
+        EXPECT_EQ(usage.values, map1.memory_usage().values);
+        auto pool_usage = pool.memory_usage();
+        EXPECT_LE(2 * VALUE_SIZE, pool_usage.values);
+        EXPECT_GT(3 * VALUE_SIZE, pool_usage.values);
+
+        // Values read from a stream are counted by the map until they are deduplicated by interning them
+        std::stringstream stream;
+        map1.serialize(stream);
+        Map<std::string, SharedValue<std::string>> read(REPLICA1_ID);
+        EXPECT_TRUE(read.deserialize(stream));
+        EXPECT_NE(read.get("0").ptr(), read.get("2").ptr());
+        EXPECT_LE(SHARED_VALUE_TEST_CASES * VALUE_SIZE, read.memory_usage().values);
+        read.intern_values(pool);
+        EXPECT_EQ(usage.values, read.memory_usage().values);
+        EXPECT_EQ(read.get("0").ptr(), read.get("2").ptr());
+        EXPECT_EQ(map1.get("0").ptr(), read.get("2").ptr());
+        EXPECT_TRUE(read.key_value_pairs() == map1.key_value_pairs());
+    }//TEST
+}//namespace
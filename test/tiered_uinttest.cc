@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <unistd.h>
+#include "../statebased/tiered.hh"
+
+namespace {
+    #define TIERED_TEST_CASES 1000
+    #define REPLICA1_ID 1
+    #define REPLICA2_ID 2
+
+    /// A temporary directory that is removed with its files at the end of a test
+    class TempDirectory {
+    private:
+        std::string _path;
+
+    public:
+        TempDirectory() {
+            char dir[] = "/tmp/crdts_tiered_XXXXXX";
+            EXPECT_NE(nullptr, mkdtemp(dir));
+            _path = dir;
+        }
+
+        ~TempDirectory() {
+            std::filesystem::remove_all(_path);
+        }
+
+        /// Gets the path of the segment store in the directory
+        std::string segments() const {
+            return _path + "/segments";
+        }
+    };
+
+    TEST(TieredMap, EvictAndFault) {
+        TempDirectory dir;
+        TieredMap<std::string, std::string> map(REPLICA1_ID, dir.segments());
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            map.put(std::to_string(i), std::string(100, 'a' + i % 26));
+        auto hot_usage = map.memory_usage();
+
+        // Keys that are accessed since the previous eviction stay hot
+        map.evict(TIERED_TEST_CASES);
+        map.get("0");
+        map.evict(TIERED_TEST_CASES / 10);
+        EXPECT_EQ(TIERED_TEST_CASES, map.size());
+        EXPECT_EQ(TIERED_TEST_CASES - TIERED_TEST_CASES / 10, map.cold_size());
+        EXPECT_TRUE(map.contains("999"));
+        EXPECT_EQ(0, map.reads());
+        EXPECT_GT(hot_usage.total() / 2, map.memory_usage().total());
+
+        map.get("0");
+        EXPECT_EQ(0, map.reads());
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            EXPECT_EQ(std::string(100, 'a' + i % 26), map.get(std::to_string(i)));
+        EXPECT_EQ(0, map.cold_size());
+
+        // Cold keys are removed without faulting them in, and puts of cold keys win over their old values
+        map.evict(0);
+        map.remove("1");
+        map.put("2", "changed");
+        EXPECT_FALSE(map.contains("1"));
+        EXPECT_EQ("changed", map.get("2"));
+        EXPECT_EQ(TIERED_TEST_CASES - 1, map.size());
+    }//TEST
+
+    TEST(TieredMap, EvictLeastRecentlyAccessed) {
+        TempDirectory dir;
+        TieredMap<std::string, std::string> map(REPLICA1_ID, dir.segments());
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            map.put(std::to_string(i), "value");
+        map.evict(TIERED_TEST_CASES);
+
+        // Keys accessed since the previous eviction are evicted last, the least recently accessed first
+        map.get("1");
+        map.get("2");
+        map.put("3", "changed");
+        map.get("1");
+        map.evict(2);
+        EXPECT_EQ(TIERED_TEST_CASES - 2, map.cold_size());
+        EXPECT_EQ("value", map.get("1"));
+        EXPECT_EQ("changed", map.get("3"));
+        EXPECT_EQ(0, map.reads());
+        EXPECT_EQ("value", map.get("2"));
+        EXPECT_EQ(1, map.reads());
+    }//TEST
+
+    TEST(TieredMap, Compact) {
+        TempDirectory dir;
+        TieredMap<std::string, std::string> map(REPLICA1_ID, dir.segments());
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            map.put(std::to_string(i), std::string(100, 'a' + i % 26));
+        map.evict(0);
+        auto size = std::filesystem::file_size(dir.segments());
+
+        // Faulting keys in and evicting them again leaves garbage, which is compacted into a new file
+        for (int round = 0; round < 4; ++round) {
+            for (int i = round % 2; i < TIERED_TEST_CASES; i += 2)
+                map.get(std::to_string(i));
+            map.evict(0);
+        }//for
+        EXPECT_GE(2 * size, std::filesystem::file_size(dir.segments()));
+        EXPECT_FALSE(std::filesystem::exists(dir.segments() + ".compact"));
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            EXPECT_EQ(std::string(100, 'a' + i % 26), map.get(std::to_string(i)));
+    }//TEST
+
+    TEST(TieredMap, MergeAsMap) {
+        // A tiered map behaves as a Map, whichever keys are evicted
+        TempDirectory dir;
+        TieredMap<std::string, std::string> tiered(REPLICA1_ID, dir.segments());
+        Map<std::string, std::string> map(REPLICA1_ID), remote_of_tiered(REPLICA2_ID), remote_of_map(REPLICA2_ID);
+        for (int i = 0; i < TIERED_TEST_CASES; ++i) {
+            auto key = std::to_string(random() % 100);
+            auto value = std::to_string(i);
+            switch (random() % 8) {
+                case 0:
+                    tiered.remove(key);
+                    map.remove(key);
+                    break;
+                case 1:
+                    remote_of_tiered.remove(key);
+                    remote_of_map.remove(key);
+                    break;
+                case 2:
+                    tiered.merge(remote_of_tiered);
+                    map.merge(remote_of_map);
+                    break;
+                case 3:
+                    remote_of_tiered.merge(tiered.state());
+                    remote_of_map.merge(map);
+                    break;
+                case 4:
+                    tiered.evict(random() % 50);
+                    break;
+                case 5:
+                    remote_of_tiered.put(key, value);
+                    remote_of_map.put(key, value);
+                    break;
+                default:
+                    tiered.put(key, value);
+                    map.put(key, value);
+            }//switch
+            EXPECT_EQ(map.contains(key), tiered.contains(key));
+            EXPECT_TRUE(tiered.state().key_value_pairs() == map.key_value_pairs());
+            EXPECT_TRUE(remote_of_tiered.key_value_pairs() == remote_of_map.key_value_pairs());
+        }//for
+    }//TEST
+
+    TEST(TieredMap, MergeSkipsSegments) {
+        TempDirectory dir;
+        TieredMap<std::string, std::string> map(REPLICA1_ID, dir.segments());
+        for (int i = 0; i < TIERED_TEST_CASES; ++i)
+            map.put(std::to_string(i), "value");
+        Map<std::string, std::string> remote(REPLICA2_ID), fresh(REPLICA2_ID + 1);
+        remote.merge(map.state());
+        map.evict(0);
+        auto reads = map.reads();
+
+        // The remote map holds every cold key, and its new adds do not touch them
+        remote.put("new", "value");
+        map.merge(remote);
+        EXPECT_EQ(reads, map.reads());
+        EXPECT_EQ("value", map.get("new"));
+
+        // A map that has not observed the adds of cold keys cannot have removed them
+        fresh.put("other", "value");
+        map.merge(fresh);
+        EXPECT_EQ(reads, map.reads());
+        EXPECT_EQ(TIERED_TEST_CASES + 2, map.size());
+
+        // A remote remove of a cold key is read from disk, and a remote put faults the key in
+        remote.remove("1");
+        remote.put("2", "changed");
+        map.merge(remote);
+        EXPECT_FALSE(map.contains("1"));
+        EXPECT_EQ(TIERED_TEST_CASES - 2, map.cold_size());
+        EXPECT_EQ("changed", map.get("2"));
+    }//TEST
+}//namespace